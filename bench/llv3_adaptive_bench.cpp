@@ -0,0 +1,162 @@
+/*------------------------------------------------------------------------------
+  Benchmark for adaptive preset selection, run against the simulated
+  register model with distance noise and bus timing enabled. For each
+  distance profile the sensor ranges for a fixed time with the maximum
+  range preset, the default preset and the adaptive controller. Achieved
+  rate, fraction of valid returns and RMS error of the valid distances are
+  printed as one JSON object per profile and method.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_adaptive.h>
+
+#ifndef LLv3_TRANSPORT_SIM
+#error "llv3_adaptive_bench needs the simulated transport (-DLLv3_TRANSPORT_SIM)"
+#endif
+
+#define BUS_NUMBER 1
+#define NOISE_CM   5.0f
+
+#define METHOD_MAX_RANGE 0
+#define METHOD_DEFAULT   1
+#define METHOD_ADAPTIVE  2
+
+static const char * methodNames[] = { "preset3", "preset0", "adaptive" };
+
+// Target distance in cm 't' seconds into a run
+typedef double (*Profile)(double t);
+
+static double closeRange(double t) { (void) t; return 80.0; }
+static double midRange(double t)   { (void) t; return 600.0; }
+static double farRange(double t)   { (void) t; return 3000.0; }
+
+// Target walking away from 0.5 m to 30 m and back every 2 seconds
+static double sweep(double t)
+{
+    return 50.0 + 2950.0 * (0.5 - 0.5 * cos(M_PI * t));
+}
+
+// Target jumping between 1 m and 20 m every quarter second
+static double steps(double t)
+{
+    return (fmod(t, 0.5) < 0.25) ? 100.0 : 2000.0;
+}
+
+static const struct
+{
+    const char * name;
+    Profile      profile;
+} profiles[] =
+{
+    { "close_80cm", closeRange },
+    { "mid_6m",     midRange   },
+    { "far_30m",    farRange   },
+    { "sweep",      sweep      },
+    { "steps",      steps      },
+};
+
+int main(int argc, char * argv[])
+{
+    LIDARLite_v3 lidar;
+    LLv3_Sample  sample;
+    __u32  durationMs = 1000;
+    __u64  start;
+    __u64  now;
+    double t;
+    double target;
+    double error;
+    double sumSq;
+    __u32  count;
+    __u32  valid;
+    __u32  p;
+    __u8   method;
+    int    opt;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': durationMs = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-t ms per run]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    LLv3_SimModel::get(BUS_NUMBER)->addDevice(LIDARLITE_ADDR_DEFAULT, 0x1234);
+    LLv3_SimModel::get(BUS_NUMBER)->setNoise(LIDARLITE_ADDR_DEFAULT, NOISE_CM);
+    LLv3_SimModel::get(BUS_NUMBER)->setBusClock(400000);
+
+    if (lidar.i2c_init(BUS_NUMBER) < 0)
+        return 1;
+
+    for (p=0 ; p<sizeof(profiles) / sizeof(profiles[0]) ; p++)
+    {
+        for (method=METHOD_MAX_RANGE ; method<=METHOD_ADAPTIVE ; method++)
+        {
+            LIDARLite_v3_Adaptive adaptive(&lidar);
+
+            if (method == METHOD_MAX_RANGE)
+                lidar.configure(3);
+            else if (method == METHOD_DEFAULT)
+                lidar.configure(0);
+
+            count = 0;
+            valid = 0;
+            sumSq = 0.0;
+            start = llv3_monotonicNs();
+            now   = start;
+
+            while (now - start < (__u64) durationMs * 1000000ull)
+            {
+                t      = (now - start) / 1e9;
+                target = profiles[p].profile(t);
+                LLv3_SimModel::get(BUS_NUMBER)->setDistance(LIDARLITE_ADDR_DEFAULT, (__u16) target);
+
+                if (method == METHOD_ADAPTIVE)
+                    adaptive.measure(&sample);
+                else
+                    lidar.measure(&sample);
+
+                count++;
+
+                if (!(sample.status & LLv3_STATUS_UNUSABLE))
+                {
+                    error  = sample.distance - (double) (__u16) target;
+                    sumSq += error * error;
+                    valid++;
+                }
+
+                now = llv3_monotonicNs();
+            }
+
+            printf("{\"bench\":\"adaptive\",\"profile\":\"%s\",\"method\":\"%s\","
+                   "\"samples_per_s\":%.1f,\"valid_per_s\":%.1f,\"valid_fraction\":%.4f,"
+                   "\"rms_error_cm\":%.2f,\"switches\":%u}\n",
+                   profiles[p].name, methodNames[method],
+                   count * 1e9 / (now - start), valid * 1e9 / (now - start),
+                   count ? (double) valid / count : 0.0,
+                   valid ? sqrt(sumSq / valid) : 0.0,
+                   (method == METHOD_ADAPTIVE) ? adaptive.getSwitchCount() : 0);
+        }
+    }
+
+    return 0;
+}
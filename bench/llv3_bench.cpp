@@ -0,0 +1,180 @@
+/*------------------------------------------------------------------------------
+  Ranging hot path benchmark. For every configure() preset it measures
+  samples per second, system calls per sample, trigger-to-result latency
+  percentiles and CPU time per sample, and prints one JSON object per preset.
+  System calls are split into those of the trigger and distance transfers,
+  which the transfer mode changes, and the busy flag reads of the wait,
+  which the wait policy changes.
+
+  Built twice by 'make bench': bin/llv3_bench.out runs on the real i2c-dev
+  bus and bin/llv3_bench_sim.out runs against the simulated register model.
+
+    llv3_bench.out [-n samples] [-b bus] [-a address] [-x] [-w spin|predict|backoff]
+
+    -x  use the LLv3_XFER_RDWR transfer mode
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+
+#define MAX_SAMPLES 100000
+#define NUM_PRESETS 7
+
+static __u64 latencies[MAX_SAMPLES];
+
+static int compareU64(const void * a, const void * b)
+{
+    __u64 x = *(const __u64 *) a;
+    __u64 y = *(const __u64 *) b;
+
+    return (x > y) - (x < y);
+}
+
+static __u64 cpuNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+    return ((__u64) now.tv_sec * 1000000000ull) + now.tv_nsec;
+}
+
+// Nearest-rank percentile of a sorted array
+static __u64 percentile(const __u64 * sorted, __u32 count, double p)
+{
+    __u32 rank = (__u32) (p / 100.0 * count);
+
+    return sorted[(rank < count) ? rank : count - 1];
+}
+
+int main(int argc, char * argv[])
+{
+    LIDARLite_v3 lidar;
+    __u32 samples  = 1000;
+    __u8  busNum   = 1;
+    __u8  address  = LIDARLITE_ADDR_DEFAULT;
+    __u8  mode     = LLv3_XFER_READWRITE;
+    __u8  wait     = LLv3_WAIT_SPIN;
+    const char * waitName = "spin";
+    __u64 wallStart;
+    __u64 wallTime;
+    __u64 cpuStart;
+    __u64 cpuTime;
+    __u64 trigger;
+    __u32 before;
+    __u32 xferSyscalls;
+    __u32 pollSyscalls;
+    __u8  preset;
+    __u32 i;
+    int   opt;
+
+    while ((opt = getopt(argc, argv, "n:b:a:xw:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': samples = strtoul(optarg, NULL, 0);  break;
+            case 'b': busNum  = strtoul(optarg, NULL, 0);  break;
+            case 'a': address = strtoul(optarg, NULL, 0);  break;
+            case 'x': mode    = LLv3_XFER_RDWR;            break;
+            case 'w':
+                waitName = optarg;
+                if (strcmp(optarg, "predict") == 0)
+                    wait = LLv3_WAIT_PREDICT;
+                else if (strcmp(optarg, "backoff") == 0)
+                    wait = LLv3_WAIT_BACKOFF;
+                else
+                    waitName = "spin";
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-b bus] [-a address] [-x] [-w spin|predict|backoff]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (samples == 0 || samples > MAX_SAMPLES)
+        samples = MAX_SAMPLES;
+
+#ifdef LLv3_TRANSPORT_SIM
+    LLv3_SimModel::get(busNum)->addDevice(address, 0x1234);
+    LLv3_SimModel::get(busNum)->setDistance(address, 500);
+#endif
+
+    if (lidar.i2c_init(busNum) < 0)
+        return 1;
+
+    lidar.setTransferMode(mode);
+    lidar.setWaitPolicy(wait, 1000000);
+
+    for (preset=0 ; preset<NUM_PRESETS ; preset++)
+    {
+        lidar.configure(preset, address);
+        lidar.waitForBusy(address);
+
+        xferSyscalls = 0;
+        pollSyscalls = 0;
+        cpuStart     = cpuNs();
+        wallStart    = llv3_monotonicNs();
+
+        for (i=0 ; i<samples ; i++)
+        {
+            trigger = llv3_monotonicNs();
+            before  = lidar.getBus()->getSyscalls();
+
+            lidar.takeRange(address);
+            xferSyscalls += lidar.getBus()->getSyscalls() - before;
+            before        = lidar.getBus()->getSyscalls();
+
+            lidar.waitForBusy(address);
+            pollSyscalls += lidar.getBus()->getSyscalls() - before;
+            before        = lidar.getBus()->getSyscalls();
+
+            lidar.readDistance(address);
+            xferSyscalls += lidar.getBus()->getSyscalls() - before;
+
+            latencies[i] = llv3_monotonicNs() - trigger;
+        }
+
+        wallTime = llv3_monotonicNs() - wallStart;
+        cpuTime  = cpuNs() - cpuStart;
+
+        qsort(latencies, samples, sizeof(latencies[0]), compareU64);
+
+        printf("{\"bench\":\"ranging\",\"transport\":\"%s\",\"xfer\":\"%s\",\"wait\":\"%s\","
+               "\"preset\":%u,\"samples\":%u,\"samples_per_sec\":%.1f,"
+               "\"xfer_syscalls_per_sample\":%.2f,\"poll_syscalls_per_sample\":%.2f,"
+               "\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f,\"p99.9\":%.1f},"
+               "\"cpu_us_per_sample\":%.2f}\n",
+#ifdef LLv3_TRANSPORT_SIM
+               "sim",
+#else
+               "i2c-dev",
+#endif
+               (mode == LLv3_XFER_RDWR) ? "rdwr" : "readwrite", waitName,
+               preset, samples, samples * 1e9 / wallTime,
+               (double) xferSyscalls / samples,
+               (double) pollSyscalls / samples,
+               percentile(latencies, samples, 50.0)  / 1000.0,
+               percentile(latencies, samples, 99.0)  / 1000.0,
+               percentile(latencies, samples, 99.9)  / 1000.0,
+               (double) cpuTime / samples / 1000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*------------------------------------------------------------------------------
+  Benchmark for the correlation record analysis. Synthetic bipolar records
+  with a known sub-sample zero crossing and added noise are analyzed in one
+  batch; throughput and estimation error are printed as one JSON object.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_corr.h>
+
+#define NUM_RECORDS   2000
+#define RECORD_LENGTH 256
+#define NOISE_LSB     4.0
+
+static __s16           records[NUM_RECORDS * RECORD_LENGTH];
+static double          truth[NUM_RECORDS];
+static LLv3_CorrResult results[NUM_RECORDS];
+
+// Uniform noise in [-amplitude, amplitude]
+static double noise(double amplitude)
+{
+    return amplitude * (2.0 * rand() / RAND_MAX - 1.0);
+}
+
+int main()
+{
+    __u32  i;
+    __u32  j;
+    __u32  valid = 0;
+    double t;
+    double v;
+    double center;
+    double error;
+    double sumError = 0.0;
+    double maxError = 0.0;
+    __u64  start;
+    __u64  elapsed;
+
+    srand(1);
+
+    // Derivative-of-Gaussian pulse: positive lobe, then negative lobe
+    for (i=0 ; i<NUM_RECORDS ; i++)
+    {
+        center   = 40.0 + (RECORD_LENGTH - 80) * (double) rand() / RAND_MAX;
+        truth[i] = center;
+
+        for (j=0 ; j<RECORD_LENGTH ; j++)
+        {
+            t = (j - center) / 4.0;
+            v = -200.0 * t * exp(0.5 - 0.5 * t * t) + noise(NOISE_LSB);
+            v = (v > 255.0) ? 255.0 : ((v < -256.0) ? -256.0 : v);
+            records[i * RECORD_LENGTH + j] = (__s16) lrint(v);
+        }
+    }
+
+    start = llv3_monotonicNs();
+    llv3_analyzeCorrelationBatch(records, RECORD_LENGTH, NUM_RECORDS, results);
+    elapsed = llv3_monotonicNs() - start;
+
+    for (i=0 ; i<NUM_RECORDS ; i++)
+    {
+        if (results[i].zeroCrossing < 0.0f)
+            continue;
+
+        error     = fabs(results[i].zeroCrossing - truth[i]);
+        sumError += error;
+        maxError  = (error > maxError) ? error : maxError;
+        valid++;
+    }
+
+    printf("{\"bench\":\"corr\",\"records\":%u,\"length\":%u,\"ns_per_record\":%.1f,"
+           "\"valid\":%u,\"mean_error_samples\":%.4f,\"max_error_samples\":%.4f}\n",
+           NUM_RECORDS, RECORD_LENGTH, (double) elapsed / NUM_RECORDS,
+           valid, valid ? sumError / valid : 0.0, maxError);
+
+    return 0;
+}
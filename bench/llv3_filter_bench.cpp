@@ -0,0 +1,103 @@
+/*------------------------------------------------------------------------------
+  Benchmark for the streaming distance filters. A synthetic moving target
+  with sensor noise and occasional outliers is run through each filter and
+  through a full pipeline; per-sample cost and RMS error against the true
+  distance are printed as one JSON object per filter.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_filter.h>
+
+#define NUM_SAMPLES  200000
+#define SAMPLE_NS    2000000ull // 500 Hz
+#define NOISE_CM     2.5
+#define OUTLIER_RATE 100        // One outlier every this many samples
+
+static float truth[NUM_SAMPLES];
+static float measured[NUM_SAMPLES];
+
+static void run(const char * name, LLv3_Filter * filter)
+{
+    double error;
+    double sumSquares = 0.0;
+    float  out;
+    __u64  start;
+    __u64  elapsed;
+    __u32  i;
+
+    filter->reset();
+
+    start = llv3_monotonicNs();
+    for (i=0 ; i<NUM_SAMPLES ; i++)
+    {
+        out        = filter->update(measured[i], i * SAMPLE_NS);
+        error      = out - truth[i];
+        sumSquares += error * error;
+    }
+    elapsed = llv3_monotonicNs() - start;
+
+    printf("{\"bench\":\"filter\",\"filter\":\"%s\",\"samples\":%u,"
+           "\"ns_per_sample\":%.1f,\"rms_error_cm\":%.3f}\n",
+           name, NUM_SAMPLES, (double) elapsed / NUM_SAMPLES,
+           sqrt(sumSquares / NUM_SAMPLES));
+}
+
+// Adapts a pipeline to the single-stage interface used by run()
+class PipelineStage : public LLv3_Filter
+{
+    public:
+        LLv3_FilterPipeline pipeline;
+        float update(float value, __u64 timestamp) { return pipeline.update(value, timestamp); }
+        void  reset (void)                         { pipeline.reset(); }
+};
+
+int main()
+{
+    LLv3_MedianFilter median(5);
+    LLv3_HampelFilter hampel(7, 3.0f);
+    LLv3_EmaFilter    ema(0.2f);
+    LLv3_KalmanFilter kalman(10000.0f, NOISE_CM * NOISE_CM);
+    PipelineStage     chain;
+    double            t;
+    __u32             i;
+
+    srand(1);
+
+    // Target sweeping between 100 and 300 cm at up to ~1 m/s
+    for (i=0 ; i<NUM_SAMPLES ; i++)
+    {
+        t           = i * SAMPLE_NS * 1e-9;
+        truth[i]    = (float) (200.0 + 100.0 * sin(t));
+        measured[i] = (float) lrint(truth[i] + NOISE_CM * (2.0 * rand() / RAND_MAX - 1.0) * 1.732);
+
+        if (i % OUTLIER_RATE == OUTLIER_RATE - 1)
+            measured[i] = 1.0f; // Spurious near-zero return
+    }
+
+    run("median5", &median);
+    run("hampel7", &hampel);
+    run("ema", &ema);
+    run("kalman", &kalman);
+
+    chain.pipeline.addStage(&hampel);
+    chain.pipeline.addStage(&kalman);
+    run("hampel7+kalman", &chain);
+
+    return 0;
+}
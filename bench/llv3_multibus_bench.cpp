@@ -0,0 +1,137 @@
+/*------------------------------------------------------------------------------
+  Benchmark for parallel acquisition on several buses, run against the
+  simulated register model with bus timing enabled. For 1 up to the maximum
+  number of buses, every bus carries the same number of sensors and is
+  acquired by LIDARLite_v3_MultiBus for a fixed time while the main thread
+  drains the merged queue. Throughput and scaling efficiency relative to a
+  single bus are printed as one JSON object per bus count.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_multibus.h>
+
+#ifndef LLv3_TRANSPORT_SIM
+#error "llv3_multibus_bench needs the simulated transport (-DLLv3_TRANSPORT_SIM)"
+#endif
+
+#define FIRST_ADDRESS 0x10
+#define DRAIN_BATCH   256
+
+int main(int argc, char * argv[])
+{
+    LLv3_Sample samples[DRAIN_BATCH];
+    __u32 maxBuses   = 4;
+    __u32 devices    = 4;
+    __u32 clockHz    = 400000;
+    __u32 durationMs = 1000;
+    __u8  pin        = 0;
+    __s32 cpus       = sysconf(_SC_NPROCESSORS_ONLN);
+    double baseRate  = 0.0;
+    double rate;
+    __u64 drained;
+    __u64 start;
+    __u64 elapsed;
+    __u32 buses;
+    __u32 b;
+    __u32 d;
+    __u32 n;
+    int   opt;
+
+    while ((opt = getopt(argc, argv, "b:d:c:t:p")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': maxBuses   = strtoul(optarg, NULL, 0); break;
+            case 'd': devices    = strtoul(optarg, NULL, 0); break;
+            case 'c': clockHz    = strtoul(optarg, NULL, 0); break;
+            case 't': durationMs = strtoul(optarg, NULL, 0); break;
+            case 'p': pin        = 1;                        break;
+            default:
+                fprintf(stderr, "usage: %s [-b max buses] [-d devices per bus] [-c bus clock Hz] [-t ms] [-p]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (maxBuses == 0 || maxBuses > LLv3_MULTIBUS_MAX_BUSES)
+        maxBuses = LLv3_MULTIBUS_MAX_BUSES;
+    if (devices == 0 || devices > LLv3_SCHED_MAX_SENSORS)
+        devices = LLv3_SCHED_MAX_SENSORS;
+    if (cpus < 1)
+        cpus = 1;
+
+    for (b=0 ; b<maxBuses ; b++)
+    {
+        // Sleep through bus time so buses overlap even with fewer cores
+        LLv3_SimModel::get(b)->setBusClock(clockHz);
+        LLv3_SimModel::get(b)->setBusSleep(1);
+
+        for (d=0 ; d<devices ; d++)
+        {
+            LLv3_SimModel::get(b)->addDevice(FIRST_ADDRESS + d, 0x1000 + 0x100 * b + d);
+            LLv3_SimModel::get(b)->setDistance(FIRST_ADDRESS + d, 100 + 50 * d);
+        }
+    }
+
+    for (buses=1 ; buses<=maxBuses ; buses++)
+    {
+        LIDARLite_v3_MultiBus multi;
+
+        for (b=0 ; b<buses ; b++)
+        {
+            if (multi.addBus(b, pin ? (__s32) (b % cpus) : -1) < 0)
+                return 1;
+
+            for (d=0 ; d<devices ; d++)
+            {
+                multi.getLidar(b)->configure(1, FIRST_ADDRESS + d);
+                multi.addSensor(b, FIRST_ADDRESS + d);
+            }
+        }
+
+        drained = 0;
+        start   = llv3_monotonicNs();
+
+        multi.start();
+
+        while (llv3_monotonicNs() - start < (__u64) durationMs * 1000000ull)
+        {
+            drained += multi.drain(samples, DRAIN_BATCH);
+            usleep(1000);
+        }
+
+        multi.stop();
+        elapsed = llv3_monotonicNs() - start;
+
+        while ((n = multi.drain(samples, DRAIN_BATCH)) > 0)
+            drained += n;
+
+        rate = drained * 1e9 / elapsed;
+        if (buses == 1)
+            baseRate = rate;
+
+        printf("{\"bench\":\"multibus\",\"buses\":%u,\"devices_per_bus\":%u,"
+               "\"bus_clock_hz\":%u,\"cpus\":%d,\"pinned\":%u,"
+               "\"samples_per_s\":%.1f,\"scaling\":%.3f,\"overruns\":%u}\n",
+               buses, devices, clockHz, cpus, pin,
+               rate, rate / (baseRate * buses), multi.getOverruns());
+    }
+
+    return 0;
+}
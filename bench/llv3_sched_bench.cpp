@@ -0,0 +1,135 @@
+/*------------------------------------------------------------------------------
+  Benchmark for the multi-sensor scheduler, run against the simulated
+  register model with bus timing enabled. For every sensor count from 1 up
+  to the maximum on one bus, the array is ranged for a fixed time with back
+  to back measure() calls, one sensor after the other, and with
+  LIDARLite_v3_Scheduler overlapping their acquisitions. Aggregate
+  throughput across the array and the speedup of the scheduler are printed
+  as one JSON object per sensor count and method.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_scheduler.h>
+
+#ifndef LLv3_TRANSPORT_SIM
+#error "llv3_sched_bench needs the simulated transport (-DLLv3_TRANSPORT_SIM)"
+#endif
+
+#define BUS_NUMBER    1
+#define FIRST_ADDRESS 0x10
+#define POLL_BATCH    LLv3_SCHED_MAX_SENSORS
+
+int main(int argc, char * argv[])
+{
+    LIDARLite_v3 lidar;
+    LLv3_Sample  samples[POLL_BATCH];
+    __u32 maxSensors = 8;
+    __u32 clockHz    = 400000;
+    __u32 durationMs = 1000;
+    __u8  preset     = 1;
+    double serialRate;
+    double schedRate;
+    __u64 count;
+    __u64 start;
+    __u64 elapsed;
+    __u32 sensors;
+    __u32 d;
+    int   opt;
+
+    while ((opt = getopt(argc, argv, "d:c:t:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': maxSensors = strtoul(optarg, NULL, 0); break;
+            case 'c': clockHz    = strtoul(optarg, NULL, 0); break;
+            case 't': durationMs = strtoul(optarg, NULL, 0); break;
+            case 'p': preset     = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-d max sensors] [-c bus clock Hz] [-t ms per run] [-p preset]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (maxSensors == 0 || maxSensors > LLv3_SCHED_MAX_SENSORS)
+        maxSensors = LLv3_SCHED_MAX_SENSORS;
+    if (preset >= LLv3_NUM_PRESETS)
+        preset = 0;
+
+    LLv3_SimModel::get(BUS_NUMBER)->setBusClock(clockHz);
+
+    for (d=0 ; d<maxSensors ; d++)
+    {
+        LLv3_SimModel::get(BUS_NUMBER)->addDevice(FIRST_ADDRESS + d, 0x1000 + d);
+        LLv3_SimModel::get(BUS_NUMBER)->setDistance(FIRST_ADDRESS + d, 100 + 50 * d);
+    }
+
+    if (lidar.i2c_init(BUS_NUMBER) < 0)
+        return 1;
+
+    for (d=0 ; d<maxSensors ; d++)
+        lidar.configure(preset, FIRST_ADDRESS + d);
+
+    for (sensors=1 ; sensors<=maxSensors ; sensors++)
+    {
+        LIDARLite_v3_Scheduler scheduler(&lidar);
+
+        // Serial: each sensor's acquisition waits for the previous one
+        count = 0;
+        start = llv3_monotonicNs();
+
+        while (llv3_monotonicNs() - start < (__u64) durationMs * 1000000ull)
+        {
+            for (d=0 ; d<sensors ; d++)
+            {
+                lidar.measure(&samples[0], FIRST_ADDRESS + d);
+                count++;
+            }
+        }
+
+        elapsed    = llv3_monotonicNs() - start;
+        serialRate = count * 1e9 / elapsed;
+
+        // Scheduled: all acquisitions in flight at once
+        for (d=0 ; d<sensors ; d++)
+            scheduler.addSensor(FIRST_ADDRESS + d);
+
+        count = 0;
+        start = llv3_monotonicNs();
+
+        scheduler.start();
+
+        while (llv3_monotonicNs() - start < (__u64) durationMs * 1000000ull)
+            count += scheduler.poll(samples, POLL_BATCH);
+
+        elapsed   = llv3_monotonicNs() - start;
+        schedRate = count * 1e9 / elapsed;
+
+        // Let the measurements still in flight finish before the next run
+        usleep(2 * lidar.getPredictedAcqUs(FIRST_ADDRESS));
+
+        printf("{\"bench\":\"sched\",\"sensors\":%u,\"bus_clock_hz\":%u,\"preset\":%u,"
+               "\"method\":\"serial\",\"samples_per_s\":%.1f}\n",
+               sensors, clockHz, preset, serialRate);
+        printf("{\"bench\":\"sched\",\"sensors\":%u,\"bus_clock_hz\":%u,\"preset\":%u,"
+               "\"method\":\"scheduler\",\"samples_per_s\":%.1f,\"speedup\":%.2f}\n",
+               sensors, clockHz, preset, schedRate, schedRate / serialRate);
+    }
+
+    return 0;
+}
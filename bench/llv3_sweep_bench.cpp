@@ -0,0 +1,89 @@
+/*------------------------------------------------------------------------------
+  Benchmark for scan frame conversion. A full frame of polar points with a
+  raster pan/tilt pattern is converted to Cartesian coordinates with
+  llv3_polarToCartesian and, for reference, with libm sinf/cosf one point
+  at a time. Per-point cost and the largest coordinate difference between
+  the two are printed as one JSON object per method.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cmath>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_sweep.h>
+
+#define NUM_POINTS LLv3_SCAN_MAX_POINTS
+#define REPEATS    2000
+
+static float range[NUM_POINTS];
+static float pan[NUM_POINTS];
+static float tilt[NUM_POINTS];
+static float x[NUM_POINTS], y[NUM_POINTS], z[NUM_POINTS];
+static float rx[NUM_POINTS], ry[NUM_POINTS], rz[NUM_POINTS];
+
+static void reference(void)
+{
+    __u32 i;
+
+    for (i=0 ; i<NUM_POINTS ; i++)
+    {
+        rx[i] = range[i] * cosf(tilt[i]) * cosf(pan[i]);
+        ry[i] = range[i] * cosf(tilt[i]) * sinf(pan[i]);
+        rz[i] = range[i] * sinf(tilt[i]);
+    }
+}
+
+int main()
+{
+    double maxError = 0.0;
+    __u64  start;
+    __u64  elapsed;
+    __u32  i;
+
+    // 64 x 64 raster, pan -pi..pi, tilt -pi/4..pi/4, ranges 0.5..40 m
+    for (i=0 ; i<NUM_POINTS ; i++)
+    {
+        pan[i]   = (float) (-M_PI + 2.0 * M_PI * (i % 64) / 63.0);
+        tilt[i]  = (float) (-M_PI / 4 + M_PI / 2 * (i / 64) / 63.0);
+        range[i] = 0.5f + 39.5f * ((i * 2654435761u) % 1000) / 999.0f;
+    }
+
+    start = llv3_monotonicNs();
+    for (i=0 ; i<REPEATS ; i++)
+        reference();
+    elapsed = llv3_monotonicNs() - start;
+
+    printf("{\"bench\":\"sweep\",\"method\":\"libm\",\"points\":%u,"
+           "\"ns_per_point\":%.2f,\"max_error_m\":0}\n",
+           NUM_POINTS, (double) elapsed / ((double) REPEATS * NUM_POINTS));
+
+    start = llv3_monotonicNs();
+    for (i=0 ; i<REPEATS ; i++)
+        llv3_polarToCartesian(range, pan, tilt, x, y, z, NUM_POINTS);
+    elapsed = llv3_monotonicNs() - start;
+
+    for (i=0 ; i<NUM_POINTS ; i++)
+    {
+        maxError = fmax(maxError, fabs(x[i] - rx[i]));
+        maxError = fmax(maxError, fabs(y[i] - ry[i]));
+        maxError = fmax(maxError, fabs(z[i] - rz[i]));
+    }
+
+    printf("{\"bench\":\"sweep\",\"method\":\"batched\",\"points\":%u,"
+           "\"ns_per_point\":%.2f,\"max_error_m\":%.2e}\n",
+           NUM_POINTS, (double) elapsed / ((double) REPEATS * NUM_POINTS), maxError);
+
+    return 0;
+}
@@ -31,6 +31,9 @@ int main()
     // Initialize i2c peripheral in the cpu core
     myLidarLite.i2c_init();
 
+    // Optionally send each transfer as a single ioctl(I2C_RDWR)
+    // myLidarLite.setTransferMode(LLv3_XFER_RDWR);
+
     // Optionally configure LIDAR-Lite
     myLidarLite.configure(0);
 
@@ -75,6 +78,9 @@ int main()
     // The 2nd argument, if non-zero, disables the default addr 0x62
     myLidarLite.setI2Caddr(i2cSecondaryAddr, true);
 
+    // Optionally sleep through each measurement instead of spinning on BUSY
+    // myLidarLite.setWaitPolicy(LLv3_WAIT_PREDICT);
+
     while(1)
     {
         myLidarLite.waitForBusy(i2cSecondaryAddr);
@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------
+  This example drives two sensors from a single-threaded epoll loop. The
+  measurement timer fd sits in the same epoll set as any other descriptor
+  the application serves (stdin here), and no call blocks while a sensor is
+  busy.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cstdio>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_async.h>
+
+LIDARLite_v3         myLidarLite;
+LIDARLite_v3_Async * myAsync;
+
+// Print each result and immediately start the next measurement
+static void onSample(const LLv3_Sample * sample, __s32 result, void * context)
+{
+    (void) context;
+
+    if (result == LLv3_OK)
+        printf("0x%02x %4d\n", sample->address, sample->distance);
+    else
+        printf("0x%02x error %d\n", sample->address, result);
+
+    myAsync->start(onSample, NULL, sample->address);
+}
+
+int main()
+{
+    struct epoll_event event;
+    struct epoll_event events[4];
+    char  line[64];
+    __s32 epollFd;
+    __s32 count;
+    __s32 i;
+
+    // Initialize i2c peripheral in the cpu core
+    if (myLidarLite.i2c_init() < 0)
+        return 1;
+
+    LIDARLite_v3_Async async(&myLidarLite);
+    myAsync = &async;
+
+    epollFd = epoll_create1(0);
+
+    event.events  = EPOLLIN;
+    event.data.fd = async.getFd();
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, async.getFd(), &event);
+
+    event.data.fd = STDIN_FILENO;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &event);
+
+    async.start(onSample, NULL, 0x44);
+    async.start(onSample, NULL, 0x46);
+
+    while(1)
+    {
+        count = epoll_wait(epollFd, events, 4, -1);
+
+        for (i=0 ; i<count ; i++)
+        {
+            if (events[i].data.fd == async.getFd())
+            {
+                async.dispatch();
+            }
+            else if (read(STDIN_FILENO, line, sizeof(line)) <= 0)
+            {
+                return 0; // Quit on end of input
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------
+  This example is a measurement broker daemon. It owns the I2C bus, ranges
+  every sensor given on the command line (default 0x62) and publishes the
+  samples through shared memory. Run any number of llv3_client.out
+  processes alongside it; they read samples without touching the bus.
+
+    llv3_broker.out [address ...]
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <atomic>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_broker.h>
+
+LIDARLite_v3      myLidarLite;
+std::atomic<bool> running(true);
+
+static void stopBroker(int signum)
+{
+    (void) signum;
+    running.store(false);
+}
+
+int main(int argc, char * argv[])
+{
+    int i;
+
+    // Initialize i2c peripheral in the cpu core
+    if (myLidarLite.i2c_init() < 0)
+        return 1;
+
+    LIDARLite_v3_Broker broker(&myLidarLite);
+
+    if (argc < 2)
+        broker.addSensor(LIDARLITE_ADDR_DEFAULT);
+
+    for (i=1 ; i<argc ; i++)
+        broker.addSensor(strtoul(argv[i], NULL, 0));
+
+    if (broker.open() < 0)
+        return 1;
+
+    // Remove the shared memory segment on Ctrl-C or kill
+    signal(SIGINT,  stopBroker);
+    signal(SIGTERM, stopBroker);
+
+    broker.run(&running);
+    broker.close();
+
+    return 0;
+}
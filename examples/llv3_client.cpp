@@ -0,0 +1,44 @@
+/*------------------------------------------------------------------------------
+  This example is a client of the measurement broker (llv3_broker.out). It
+  prints every sample the broker publishes and never touches the I2C bus.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_broker.h>
+
+LIDARLite_v3_Client myClient;
+
+int main()
+{
+    LLv3_Sample samples[64];
+    __u32       count;
+    __u32       i;
+
+    if (myClient.connect() < 0)
+        return 1;
+
+    while(1)
+    {
+        count = myClient.drain(samples, 64);
+
+        for (i=0 ; i<count ; i++)
+            printf("0x%02x %4d\n", samples[i].address, samples[i].distance);
+
+        usleep(10000);
+    }
+}
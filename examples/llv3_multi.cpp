@@ -0,0 +1,65 @@
+/*------------------------------------------------------------------------------
+  This example illustrates how to range several LIDAR-Lites sharing one I2C
+  bus with the multi-sensor scheduler. Each unit must already answer on its
+  own address; see setI2Caddr and the alternate address example in llv3.cpp.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_scheduler.h>
+#include <include/lidarlite_v3_frame.h>
+
+LIDARLite_v3 myLidarLite;
+
+int main()
+{
+    LLv3_Sample samples[8];
+    LLv3_Frame  frame;
+    __u32       count;
+    __u32       i;
+
+    // Initialize i2c peripheral in the cpu core
+    myLidarLite.i2c_init();
+
+    LIDARLite_v3_Scheduler      scheduler(&myLidarLite);
+    LIDARLite_v3_FrameAssembler assembler;
+
+    scheduler.addSensor(0x44);
+    scheduler.addSensor(0x46);
+    scheduler.addSensor(0x48);
+
+    assembler.addSensor(0x44);
+    assembler.addSensor(0x46);
+    assembler.addSensor(0x48);
+
+    // Trigger all sensors so their measurements overlap
+    scheduler.start();
+
+    while(1)
+    {
+        // Harvest whichever sensors have finished and re-trigger them
+        count = scheduler.poll(samples, 8);
+
+        // Print one line per frame, all distances aligned to the same time
+        for (i=0 ; i<count ; i++)
+        {
+            if (assembler.push(&samples[i], &frame))
+                printf("%6.1f %6.1f %6.1f  spread %llu us\n",
+                       frame.distance[0], frame.distance[1], frame.distance[2],
+                       (unsigned long long) frame.spreadNs / 1000);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+  This example illustrates how to record a ranging session and replay it
+  later without any hardware.
+
+    llv3_replay.out record session.llv3    Range for 1000 samples and record
+    llv3_replay.out replay session.llv3    Replay at the recorded speed
+    llv3_replay.out fast   session.llv3    Replay as fast as possible
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cstring>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_record.h>
+
+LIDARLite_v3          myLidarLite;
+LIDARLite_v3_Recorder myRecorder;
+LIDARLite_v3_Replay   myReplay;
+
+int main(int argc, char * argv[])
+{
+    __u16 distance;
+    __u32 i;
+
+    if (argc != 3)
+    {
+        printf("usage: %s record|replay|fast <file>\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "record") == 0)
+    {
+        // Initialize i2c peripheral in the cpu core
+        if (myLidarLite.i2c_init() < 0 || myRecorder.open(argv[2]) < 0)
+            return 1;
+
+        myLidarLite.setRecorder(&myRecorder);
+    }
+    else
+    {
+        // No i2c_init: every transaction is served from the recording
+        if (myReplay.open(argv[2]) < 0)
+            return 1;
+
+        myReplay.setRealtime(strcmp(argv[1], "replay") == 0);
+        myLidarLite.setReplay(&myReplay);
+    }
+
+    myLidarLite.configure(0);
+
+    for (i=0 ; i<1000 ; i++)
+    {
+        if (myLidarLite.waitForBusy() < 0)
+            break;
+
+        myLidarLite.takeRange();
+        distance = myLidarLite.readDistance();
+
+        printf("%4d\n", distance);
+    }
+
+    myRecorder.close();
+
+    return 0;
+}
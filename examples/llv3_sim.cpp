@@ -0,0 +1,94 @@
+/*------------------------------------------------------------------------------
+  This example runs the library against the simulated LIDAR-Lite register
+  model, so it needs no Raspberry Pi or sensor. It is built with
+  -DLLv3_TRANSPORT_SIM (see 'make sim'). It moves a simulated unit to an
+  alternate address, ranges with both transfer modes and reports the system
+  calls the i2c-dev transport would have made to trigger and read each
+  measurement.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+
+#include <include/lidarlite_v3.h>
+
+#define i2cSecondaryAddr 0x44
+#define MEASUREMENTS     200
+
+LIDARLite_v3       myLidarLite;
+LLv3_StatsSnapshot stats;
+
+int main()
+{
+    LLv3_SimModel * model = LLv3_SimModel::get(1);
+    __u16 distance = 0;
+    __u32 syscalls;
+    __u32 start;
+    __u8  mode;
+    __u32 i;
+
+    // One simulated unit on bus 1 at the default address
+    model->addDevice(LIDARLITE_ADDR_DEFAULT, 0x1234);
+    model->setDistance(LIDARLITE_ADDR_DEFAULT, 250);
+
+    // Initialize i2c peripheral in the cpu core
+    myLidarLite.i2c_init(1);
+
+    // Move the unit to an alternate address, as on real hardware
+    myLidarLite.setI2Caddr(i2cSecondaryAddr, true);
+
+    for (mode=LLv3_XFER_READWRITE ; mode<=LLv3_XFER_RDWR ; mode++)
+    {
+        myLidarLite.setTransferMode(mode);
+        myLidarLite.configure(1, i2cSecondaryAddr);
+
+        syscalls = 0;
+
+        for (i=0 ; i<MEASUREMENTS ; i++)
+        {
+            myLidarLite.waitForBusy(i2cSecondaryAddr);
+
+            start    = myLidarLite.getBus()->getSyscalls();
+            myLidarLite.takeRange(i2cSecondaryAddr);
+            distance = myLidarLite.readDistance(i2cSecondaryAddr);
+            syscalls += myLidarLite.getBus()->getSyscalls() - start;
+        }
+
+        printf("mode %u: distance %4d, %.1f syscalls per measurement\n",
+               mode, distance, (double) syscalls / MEASUREMENTS);
+    }
+
+    // Brown the unit out; measure() reopens the bus, moves the unit back to
+    // its secondary address and reapplies configure(1) before retrying
+    LLv3_Sample sample;
+
+    model->powerCycle(i2cSecondaryAddr);
+
+    if (myLidarLite.measure(&sample, i2cSecondaryAddr) == LLv3_OK)
+        printf("after brownout: distance %4d\n", sample.distance);
+    else
+        printf("after brownout: no valid measurement\n");
+
+    // Transfer instrumentation collected along the way
+    myLidarLite.getStats()->snapshot(&stats);
+
+    printf("reads %llu, p50 %llu ns, p99 %llu ns, errors %llu, recovery %llu ns\n",
+           (unsigned long long) stats.ops[LLv3_OP_READ],
+           (unsigned long long) llv3_statsPercentileNs(&stats, LLv3_OP_READ, 0.50),
+           (unsigned long long) llv3_statsPercentileNs(&stats, LLv3_OP_READ, 0.99),
+           (unsigned long long) stats.errorsTotal,
+           (unsigned long long) stats.latencyNs[LLv3_OP_RECOVER]);
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*------------------------------------------------------------------------------
+  This example illustrates how to stream distances from LIDAR-Lite with the
+  background acquisition engine. The sensor ranges continuously on its own
+  thread while the main loop drains buffered samples in batches.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <unistd.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_stream.h>
+
+LIDARLite_v3 myLidarLite;
+
+int main()
+{
+    LLv3_Sample samples[64];
+    __u32       count;
+    __u32       overruns = 0;
+    __u32       i;
+
+    // Initialize i2c peripheral in the cpu core
+    myLidarLite.i2c_init();
+
+    // Optionally configure LIDAR-Lite
+    myLidarLite.configure(0);
+
+    LIDARLite_v3_Stream stream(&myLidarLite);
+
+    stream.start();
+
+    while(1)
+    {
+        // The control loop never waits on the bus; it only drains the ring
+        count = stream.drain(samples, 64);
+
+        for (i=0 ; i<count ; i++)
+        {
+            printf("%llu %4d 0x%02x\n", (unsigned long long) samples[i].timestamp,
+                   samples[i].distance, samples[i].status);
+        }
+
+        // Report samples dropped because this loop fell behind
+        if (stream.getOverruns() != overruns)
+        {
+            overruns = stream.getOverruns();
+            printf("overruns: %u\n", overruns);
+        }
+
+        usleep(10000);
+    }
+}
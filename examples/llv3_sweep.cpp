@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------------
+  This example builds 2D scans with the sensor on a pan servo that sweeps
+  back and forth at a constant rate. The angle source computes the servo
+  position from the measurement time; with an encoder, read it there
+  instead. Every scan is written as scan_<n>.pcd.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cmath>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_sweep.h>
+
+#define SWEEP_NS      2000000000ull // One pass from -90 to +90 degrees
+#define SWEEP_RADIANS M_PI
+
+LIDARLite_v3 myLidarLite;
+__u64        sweepStart;
+
+// Servo angle at 'timestamp': a triangle wave between -pi/2 and pi/2
+static void servoAngle(__u64 timestamp, float * pan, float * tilt, void * context)
+{
+    __u64  phase = (timestamp - sweepStart) % (2 * SWEEP_NS);
+    double t     = (double) phase / SWEEP_NS;
+
+    (void) context;
+
+    if (t > 1.0)
+        t = 2.0 - t;
+
+    *pan  = (float) (SWEEP_RADIANS * (t - 0.5));
+    *tilt = 0.0f;
+}
+
+int main()
+{
+    LLv3_ScanFrame * frame;
+    char  path[32];
+    __u64 passEnd;
+
+    // Initialize i2c peripheral in the cpu core
+    if (myLidarLite.i2c_init() < 0)
+        return 1;
+
+    // Short range, high speed
+    myLidarLite.configure(1);
+
+    LIDARLite_v3_Sweep sweep(&myLidarLite, servoAngle, NULL);
+
+    sweepStart = llv3_monotonicNs();
+    passEnd    = sweepStart + SWEEP_NS;
+
+    while(1)
+    {
+        // One scan per servo pass
+        sweep.begin();
+
+        while (llv3_monotonicNs() < passEnd)
+        {
+            if (sweep.step() < 0)
+                break; // Frame full
+        }
+
+        passEnd += SWEEP_NS;
+
+        frame = sweep.end();
+
+        snprintf(path, sizeof(path), "scan_%llu.pcd", (unsigned long long) frame->sequence);
+        llv3_writePcd(path, frame);
+
+        printf("%s: %u points, %u dropped\n", path, frame->numPoints, frame->dropped);
+
+        sweep.release(frame);
+    }
+}
@@ -20,6 +20,11 @@
 #ifndef LIDARLite_v3_h
 #define LIDARLite_v3_h
 
+#include <linux/types.h>
+#include <linux/i2c.h>
+
+#include <include/lidarlite_v3_stats.h>
+
 // LIDAR-Lite default I2C device address
 #define LIDARLITE_ADDR_DEFAULT 0x62
 
@@ -28,6 +33,9 @@
 #define LLv3_STATUS        0x01
 #define LLv3_SIG_CNT_VAL   0x02
 #define LLv3_ACQ_CONFIG    0x04
+#define LLv3_PEAK_CORR     0x0c
+#define LLv3_NOISE_PEAK    0x0d
+#define LLv3_SIGNAL_STRENGTH 0x0e
 #define LLv3_DISTANCE      0x0f
 #define LLv3_REF_CNT_VAL   0x12
 #define LLv3_UNIT_ID_HIGH  0x16
@@ -41,21 +49,254 @@
 #define LLv3_CORR_DATA     0x52
 #define LLv3_ACQ_SETTINGS  0x5d
 
+// Bus transport, chosen at compile time so that transfers are plain
+// non-virtual calls. Build with -DLLv3_TRANSPORT_SIM to run against the
+// in-process register model instead of the Linux i2c-dev driver.
+#ifdef LLv3_TRANSPORT_SIM
+#include <include/lidarlite_v3_sim.h>
+typedef LLv3_SimBus    LLv3_Bus;
+#else
+#include <include/lidarlite_v3_i2cdev.h>
+typedef LLv3_I2cDevBus LLv3_Bus;
+#endif
+
+// Transfer modes used by i2cWrite and i2cRead
+#define LLv3_XFER_READWRITE 0 // I2C_SLAVE ioctl + one write()/read() per step
+#define LLv3_XFER_RDWR      1 // One combined ioctl(I2C_RDWR) per operation
+
+// Maximum number of messages queued for one I2C_RDWR submission
+// (the kernel accepts at most I2C_RDWR_IOCTL_MAX_MSGS = 42)
+#define LLv3_BATCH_MAX_MSGS 32
+
+// Number of correlation samples fetched per I2C_RDWR submission (one
+// register write and one 2-byte read message per sample)
+#define LLv3_CORR_BURST_SAMPLES (LLv3_BATCH_MAX_MSGS / 2)
+
+// Number of devices whose configuration registers are shadowed, and number
+// of shadowed registers per device (see llv3_shadowIndex)
+#define LLv3_SHADOW_MAX_DEVICES 16
+#define LLv3_SHADOW_NUM_REGS    7
+
+// Wait policies used by waitForBusy
+#define LLv3_WAIT_SPIN     0 // Read the busy flag back to back
+#define LLv3_WAIT_PREDICT  1 // Sleep through the predicted measurement, then poll
+#define LLv3_WAIT_BACKOFF  2 // Poll with exponentially growing sleeps
+#define LLv3_WAIT_GPIO     3 // Block on the mode pin status output (configure(6))
+
+// Approximate time taken by one acquisition, in microseconds. Used to predict
+// the duration of a measurement from the active acquisition counts.
+#define LLv3_ACQ_PERIOD_US       28
+
+// Sleep between polls once the predicted time has passed, and the first and
+// largest sleeps used by LLv3_WAIT_BACKOFF, in microseconds
+#define LLv3_WAIT_POLL_US        20
+#define LLv3_WAIT_BACKOFF_MAX_US 1000
+
+// Result codes of measure() and recover()
+#define LLv3_OK            0
+#define LLv3_ERR_BUS      -1 // A transfer failed or was not acknowledged
+#define LLv3_ERR_TIMEOUT  -2 // The measurement did not finish before its deadline
+#define LLv3_ERR_RECOVERY -3 // The bus could not be reopened or the device stayed silent
+
+// Defaults of setRetryPolicy: attempts after the first, first sleep between
+// attempts (doubled per attempt up to the maximum), in microseconds
+#define LLv3_RETRY_MAX_DEFAULT    2
+#define LLv3_RETRY_BACKOFF_US     500
+#define LLv3_RETRY_BACKOFF_MAX_US 20000
+
+// Margin added to twice the preset's worst case measurement time to form
+// the default per-attempt deadline of measure(), in microseconds
+#define LLv3_DEADLINE_SLACK_US    2000
+
+// STATUS bit set by the device when no valid return was detected; the
+// distance of such a measurement is meaningless
+#define LLv3_STATUS_NO_SIGNAL 0x08
+
+// Set in LLv3_Sample::status by measure() when no distance could be
+// obtained. STATUS bit 7 is not used by the device.
+#define LLv3_STATUS_INVALID 0x80
+
+// Either of the above: consumers of samples must skip the distance
+#define LLv3_STATUS_UNUSABLE (LLv3_STATUS_NO_SIGNAL | LLv3_STATUS_INVALID)
+
+// Upper bound on the duration of one measurement, in microseconds. Strong
+// returns and quick termination detection end a measurement earlier.
+static inline constexpr __u32 llv3_acqTimeUs(__u8 sigCountMax, __u8 refCountMax)
+{
+    return ((__u32) sigCountMax + refCountMax) * LLv3_ACQ_PERIOD_US;
+}
+
+// Register values applied by configure()
+struct LLv3_Preset
+{
+    __u8 sigCountMax;     // SIG_CNT_VAL: maximum acquisition count
+    __u8 acqConfigReg;    // ACQ_CONFIG: quick termination, mode pin function
+    __u8 refCountMax;     // REF_CNT_VAL: reference acquisition count
+    __u8 thresholdBypass; // THRESH_BYPASS: detection threshold override
+
+    // Worst case measurement time with this preset, in microseconds
+    constexpr __u32 acqTimeUs(void) const
+    {
+        return llv3_acqTimeUs(sigCountMax, refCountMax);
+    }
+};
+
+// Built-in presets selected by configure(0) .. configure(6)
+#define LLv3_NUM_PRESETS 7
+
+static constexpr LLv3_Preset LLv3_PRESETS[LLv3_NUM_PRESETS] =
+{
+    { 0x80, 0x08, 0x05, 0x00 }, // 0: Default mode, balanced performance
+    { 0x1d, 0x08, 0x03, 0x00 }, // 1: Short range, high speed
+    { 0x80, 0x00, 0x03, 0x00 }, // 2: Default range, higher speed short range
+    { 0xff, 0x08, 0x05, 0x00 }, // 3: Maximum range
+    { 0x80, 0x08, 0x05, 0x80 }, // 4: High sensitivity detection
+    { 0x80, 0x08, 0x05, 0xb0 }, // 5: Low sensitivity detection
+    { 0x04, 0x01, 0x03, 0x00 }, // 6: Short range, high speed, higher error
+};
+
+// Worst case measurement time of a built-in preset, known at compile time
+static inline constexpr __u32 llv3_presetAcqTimeUs(__u8 configuration)
+{
+    return LLv3_PRESETS[configuration < LLv3_NUM_PRESETS ? configuration : 0].acqTimeUs();
+}
+
+// One completed distance measurement
+struct LLv3_Sample
+{
+    __u64 timestamp; // llv3_monotonicNs() time the measurement completed
+    __u64 trigger;   // llv3_monotonicNs() time it was triggered, 0 if unknown
+    __u16 distance;  // Distance in cm
+    __u8  status;    // STATUS register value read at completion
+    __u8  address;   // I2C device address of the sensor
+    __u8  bus;       // Number of the /dev/i2c-N bus the sensor is on
+    __u8  signal;    // SIGNAL_STRENGTH at completion, 0 if not read
+};
+
+// Host-side copy of one device's configuration and identity registers
+struct LLv3_Shadow
+{
+    __u8  address;  // I2C device address
+    __u8  used;
+    __u16 valid;    // Bit n set when values[n] matches the device
+    __u8  values[LLv3_SHADOW_NUM_REGS];
+};
+
+// Configuration a device needs again after a power loss, see recover(),
+// and the timing of its measurements
+struct LLv3_DeviceSetup
+{
+    __u8  address;        // I2C device address
+    __u8  used;
+    __u8  hasPreset;      // 'preset' was applied with configure()
+    __u8  secondary;      // 'address' was assigned with setI2Caddr()
+    __u8  fromAddress;    // Address setI2Caddr() reached the device at
+    __u8  disableDefault;
+    LLv3_Preset preset;
+    __u64 triggerNs;      // Time of the last takeRange or measure, 0 if none
+};
+
+// Current CLOCK_MONOTONIC_RAW time in nanoseconds. Unlike CLOCK_MONOTONIC
+// it is never slewed by NTP, so intervals between samples are exact in the
+// local oscillator's time base.
+__u64 llv3_monotonicNs(void);
+
+// Convert raw correlation samples in place. On entry each element holds the
+// two bytes read from CORR_DATA in bus order: magnitude byte, then sign byte.
+void  llv3_signExtendCorrelation(__s16 * values, __u16 count);
+
+// Receives one chunk of a streamed correlation record
+typedef void (*LLv3_CorrHandler)(const __s16 * chunk, __u16 offset, __u16 count, void * context);
+
+class LIDARLite_v3_Recorder;
+class LIDARLite_v3_Replay;
+
 class LIDARLite_v3
 {
-        __u32     file_i2c;
+        LLv3_Bus  bus;
+        __s16     boundAddress; // Slave address bound to the bus, -1 if none
+        __u32     slaveBindCount;
+        __u32     slaveBindSkipped;
+        __u8      xferMode;
+        __u8      waitPolicy;
+        __u32     waitTimeoutUs;
+        __s32     gpioFd;         // Mode pin line event fd (device address
+                                  // in simulation), -1 if not set up
+        __u8      gpioBusyLevel;
+        __u8      lastStatus;     // Last STATUS value read by getStatus
+        LLv3_Shadow shadows[LLv3_SHADOW_MAX_DEVICES];
+        __u32     shadowHits;
+        __u32     shadowMisses;
+        LLv3_DeviceSetup setups[LLv3_SHADOW_MAX_DEVICES];
+        __u8      busNumber;      // Bus opened by i2c_init, reopened by recover
+        __u8      retryMax;
+        __u32     retryBackoffUs;
+        __u32     deadlineUs;     // Per attempt; 0 derives it from the preset
+        LIDARLite_v3_Recorder * recorder;
+        LIDARLite_v3_Replay *   replay;
+        __u8      batchDepth;
+        __u8      batchCount;
+        __u8      batchData[LLv3_BATCH_MAX_MSGS][2];
+        struct i2c_msg batchMsgs[LLv3_BATCH_MAX_MSGS];
+        LLv3_Stats stats;
+
+        __s32     i2cFlush    (void);
+        __s32     i2cWriteBus (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress);
+        __s32     i2cReadBus  (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress);
+        LLv3_Shadow * shadowFor (__u8 lidarliteAddress, __u8 create);
+        __s8      shadowLookup (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress, __u8 isWrite);
+        void      shadowStore (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress, __u8 success);
+        void      forgetShadow (__u8 lidarliteAddress);
+        __s32     correlationBurst (__s16 * corrValues, __u16 count, __u8 lidarliteAddress);
+        void      statsOp     (__u8 op, __u64 startNs, __u8 failed, __u8 regAddr, __u8 lidarliteAddress);
+        LLv3_DeviceSetup * setupFor (__u8 lidarliteAddress, __u8 create);
+        __s32     waitUntil   (__u64 deadline, __u8 lidarliteAddress);
+        __s32     measureOnce (LLv3_Sample * sample, __u8 lidarliteAddress);
     public:
-        __s32     i2c_init    (void);
+                  LIDARLite_v3(void);
+                  ~LIDARLite_v3(void);
+        void      setTransferMode (__u8 mode);
+        LLv3_Bus * getBus     (void);
+        __u32     getSlaveBindCount   (void);
+        __u32     getSlaveBindSkipped (void);
+        LLv3_Stats * getStats (void);
+        void      beginBatch  (void);
+        __s32     endBatch    (void);
+        __s32     i2c_init    (__u8 busNumber = 1);
+        __u8      getBusNumber (void);
         __s32     i2c_connect (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
         void      configure   (__u8 configuration = 0, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        void      configure   (const LLv3_Preset & preset, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        void      invalidateShadow (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __u32     getShadowHits   (void);
+        __u32     getShadowMisses (void);
+
+        // Apply a built-in preset chosen at compile time
+        template <__u8 configuration>
+        void      configure   (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT)
+        {
+            static_assert(configuration < LLv3_NUM_PRESETS, "unknown LIDAR-Lite preset");
+            configure(LLv3_PRESETS[configuration], lidarliteAddress);
+        }
         void      setI2Caddr  (__u8 newAddress, __u8 disableDefault, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
         __u16     readDistance(__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
-        void      waitForBusy (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     waitForBusy (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        void      setWaitPolicy (__u8 policy, __u32 timeoutUs = 0);
+        __u32     getPredictedAcqUs (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     gpioInit    (const char * chipPath, __u32 lineOffset, __u8 busyLevel = 1);
+        void      setRecorder (LIDARLite_v3_Recorder * sessionRecorder);
+        void      setReplay   (LIDARLite_v3_Replay * sessionReplay);
         __u8      getBusyFlag (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __u8      getStatus   (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
         void      takeRange   (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     measure     (LLv3_Sample * sample, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        void      setRetryPolicy (__u8 maxRetries, __u32 backoffUs = LLv3_RETRY_BACKOFF_US, __u32 attemptDeadlineUs = 0);
+        __s32     recover     (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
         __s32     i2cWrite    (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
         __s32     i2cRead     (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
-        void      correlationRecordRead (__s16 * corrValues, __u16 numberOfReadings = 256, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     correlationRecordRead (__s16 * corrValues, __u16 numberOfReadings = 256, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     correlationRecordStream (__s16 * chunkBuffer, LLv3_CorrHandler handler, void * context,
+                                           __u16 numberOfReadings = 256, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
 };
 
 #endif
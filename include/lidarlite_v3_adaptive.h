@@ -0,0 +1,101 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Adaptive acquisition settings
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_adaptive_h
+#define LIDARLite_v3_adaptive_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Most rungs a ladder may have
+#define LLv3_ADAPT_MAX_RUNGS 8
+
+// Defaults of setThresholds: signal strength below which a rung is left for
+// a slower one, consecutive samples inside a faster rung's range before
+// switching to it, and the fraction of that range, in percent, a sample
+// must fall inside
+#define LLv3_ADAPT_WEAK_SIGNAL 48
+#define LLv3_ADAPT_UP_COUNT    8
+#define LLv3_ADAPT_MARGIN_PCT  80
+
+// Samples after which a learned range limit is forgotten so that a rung
+// is tried again, e.g. because the target became more reflective
+#define LLv3_ADAPT_FORGET_SAMPLES 1024
+
+// Default ladder, fastest first: acquisition count 4, 29 and 128 with
+// quick termination, then the maximum range preset
+#define LLv3_ADAPT_NUM_RUNGS 4
+
+static constexpr LLv3_Preset LLv3_ADAPT_LADDER[LLv3_ADAPT_NUM_RUNGS] =
+{
+    { 0x04, 0x00, 0x03, 0x00 },
+    { 0x1d, 0x00, 0x03, 0x00 },
+    { 0x80, 0x00, 0x03, 0x00 },
+    { 0xff, 0x08, 0x05, 0x00 },
+};
+
+/*------------------------------------------------------------------------------
+  LIDARLite_v3_Adaptive
+  Picks the fastest acquisition settings that still give valid returns at
+  the distance currently seen. Settings form a ladder of presets ordered
+  from fastest to longest range, and every measure() may move one rung:
+
+    down (slower): the return was invalid or its signal strength fell below
+      the weak threshold. The last valid distance becomes the rung's range
+      limit.
+    up (faster): the last 'upCount' distances were all inside the margin of
+      the faster rung's range limit, or that rung has no known limit.
+
+  A failed attempt on a faster rung costs one invalid sample and teaches
+  its limit, so the controller only tries it again once the target comes
+  clearly closer; the gap between the limit and the margin keeps it from
+  switching back and forth at the boundary. Limits are forgotten after
+  LLv3_ADAPT_FORGET_SAMPLES samples.
+
+  Settings are applied with configure(const LLv3_Preset &), whose register
+  shadow writes only the registers that differ between rungs.
+------------------------------------------------------------------------------*/
+class LIDARLite_v3_Adaptive
+{
+        LIDARLite_v3 * lidar;
+        __u8      address;
+        LLv3_Preset ladder[LLv3_ADAPT_MAX_RUNGS];
+        __u8      numRungs;
+        __u8      rung;
+        __u8      applied;      // Current rung written to the device
+        __u16     limitCm[LLv3_ADAPT_MAX_RUNGS]; // 0 while unknown
+        __u32     limitAge[LLv3_ADAPT_MAX_RUNGS];
+        __u8      weakSignal;
+        __u8      upCount;
+        __u8      marginPct;
+        __u8      streak;       // Consecutive samples allowing a step up
+        __u16     lastValidCm;
+        __u32     switches;
+
+        void      select      (__u8 newRung);
+    public:
+                  LIDARLite_v3_Adaptive (LIDARLite_v3 * lidarlite,
+                                         __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __s32     setLadder   (const LLv3_Preset * rungs, __u8 count);
+        void      setThresholds (__u8 weak, __u8 samplesUp = LLv3_ADAPT_UP_COUNT,
+                                 __u8 margin = LLv3_ADAPT_MARGIN_PCT);
+        __s32     measure     (LLv3_Sample * sample);
+        __u8      getRung     (void);
+        __u32     getSwitchCount (void);
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Non-blocking measurements for event loops
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_async_h
+#define LIDARLite_v3_async_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Maximum number of measurements in flight, at most one per device
+#define LLv3_ASYNC_MAX_OPS 16
+
+// Receives a finished measurement. 'result' is LLv3_OK, LLv3_ERR_BUS or
+// LLv3_ERR_TIMEOUT; on failure the sample has LLv3_STATUS_INVALID set.
+// The handler may start the next measurement of the same device.
+typedef void (*LLv3_AsyncHandler)(const LLv3_Sample * sample, __s32 result, void * context);
+
+/*------------------------------------------------------------------------------
+  LIDARLite_v3_Async
+  Runs measurements as a state machine driven by a timerfd instead of
+  blocking in waitForBusy. Add getFd() to an epoll/poll set for reading and
+  call dispatch() whenever it becomes readable; handlers run from
+  dispatch(). Each measurement goes through
+
+    start(): trigger with takeRange, wait for the predicted acquisition time
+    dispatch(): read STATUS; if still busy, wait again with backoff
+    dispatch(): read the distance and call the handler
+
+  The register transfers themselves are short synchronous syscalls; only
+  the waits for the device are handed back to the event loop. All calls
+  must come from the thread running the loop.
+------------------------------------------------------------------------------*/
+class LIDARLite_v3_Async
+{
+        struct Op
+        {
+            __u8  active;
+            __u8  address;
+            __u64 trigger;   // llv3_monotonicNs() of the takeRange
+            __u64 due;       // Next STATUS check
+            __u64 deadline;  // Give up with LLv3_ERR_TIMEOUT after this
+            __u32 backoffUs; // Next wait if the device is still busy
+            LLv3_AsyncHandler handler;
+            void * context;
+        };
+
+        LIDARLite_v3 * lidar;
+        __s32     timerFd;
+        Op        ops[LLv3_ASYNC_MAX_OPS];
+
+        void      arm         (void);
+        void      complete    (Op * op, __s32 result, __u16 distance, __u8 status);
+    public:
+                  LIDARLite_v3_Async (LIDARLite_v3 * lidarlite);
+                  ~LIDARLite_v3_Async(void);
+        __s32     getFd       (void);
+        __s32     start       (LLv3_AsyncHandler handler, void * context,
+                               __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        void      cancel      (__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __u32     pending     (void);
+        __u32     dispatch    (void);
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Measurement broker
+
+  One broker process owns the I2C bus and runs the acquisition loop for all
+  sensors. It publishes every sample into a POSIX shared memory segment that
+  any number of local client processes map read-only. Clients never touch the
+  bus, so adding consumers adds no I2C traffic.
+
+  Shared memory layout (LLv3_BrokerShm)
+  ------------------------------------------------------------------------------
+  latest[]: newest sample of each sensor, one seqlocked slot per sensor
+  ring[]:   every sample in publication order. Slot (n % LLv3_BROKER_RING_SIZE)
+            holds sample n; its sequence number is 2n+1 while the broker is
+            writing it and 2n+2 once complete, so a reader can tell both a
+            torn read and a slot that has already been reused.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_broker_h
+#define LIDARLite_v3_broker_h
+
+#include <linux/types.h>
+#include <atomic>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_scheduler.h>
+
+// Default shared memory object name
+#define LLv3_BROKER_NAME      "/llv3_broker"
+
+#define LLv3_BROKER_MAGIC     0x4c4c7633 // "LLv3"
+#define LLv3_BROKER_VERSION   5
+
+// Samples kept for clients that drain the stream (power of two)
+#define LLv3_BROKER_RING_SIZE 4096
+
+// One seqlocked sample
+struct LLv3_BrokerSlot
+{
+    std::atomic<__u64> seq;
+    LLv3_Sample        sample;
+};
+
+struct LLv3_BrokerShm
+{
+    __u32              magic;
+    __u32              version;
+    __s32              owner;      // Process id of the broker
+    std::atomic<__u64> published;  // Number of samples written to ring[]
+    __u8               numSensors;
+    __u8               addresses[LLv3_SCHED_MAX_SENSORS];
+    LLv3_BrokerSlot    latest[LLv3_SCHED_MAX_SENSORS];
+    LLv3_BrokerSlot    ring[LLv3_BROKER_RING_SIZE];
+};
+
+// Bus-owning side, normally run by a dedicated daemon
+class LIDARLite_v3_Broker
+{
+        LIDARLite_v3_Scheduler scheduler;
+        LLv3_BrokerShm * shm;
+        __s32     lockFd;     // Segment fd, locked while open
+        char      name[64];
+        __u8      addresses[LLv3_SCHED_MAX_SENSORS];
+        __u8      numSensors;
+        __u8      started;
+
+        void      publish     (const LLv3_Sample * sample);
+    public:
+                  LIDARLite_v3_Broker (LIDARLite_v3 * lidarlite);
+                  ~LIDARLite_v3_Broker(void);
+        __s32     addSensor   (__u8 lidarliteAddress);
+        __s32     open        (const char * shmName = LLv3_BROKER_NAME);
+        void      close       (void);
+        __u32     step        (void);
+        void      run         (std::atomic<bool> * running);
+};
+
+// Subscriber side, mirroring the LIDARLite_v3 reading API
+class LIDARLite_v3_Client
+{
+        const LLv3_BrokerShm * shm;
+        __u64     cursor;     // Next sample number drain() will return
+        __u64     lost;       // Samples overwritten before drain() saw them
+
+    public:
+                  LIDARLite_v3_Client (void);
+                  ~LIDARLite_v3_Client(void);
+        __s32     connect     (const char * shmName = LLv3_BROKER_NAME);
+        void      disconnect  (void);
+        __s32     getLatest   (LLv3_Sample * sample, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __u16     readDistance(__u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        __u32     drain       (LLv3_Sample * samples, __u32 maxSamples);
+        __u64     getLost     (void);
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Correlation record analysis
+
+  Host-side estimators over records returned by correlationRecordRead. The
+  record is bipolar: a positive going portion followed by a roughly
+  symmetrical negative going pulse. The zero crossing between the two peaks
+  is the effective delay, which is located here to a fraction of a sample.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_corr_h
+#define LIDARLite_v3_corr_h
+
+#include <linux/types.h>
+
+// Analysis of one correlation record
+struct LLv3_CorrResult
+{
+    float zeroCrossing;      // Interpolated crossing position in samples, -1 if none
+    __s16 peakPositive;      // Largest sample value
+    __s16 peakNegative;      // Smallest sample value
+    __u16 peakPositiveIndex;
+    __u16 peakNegativeIndex;
+    float noiseRms;          // RMS of the samples outside the pulse
+    float snr;               // Pulse half amplitude over noiseRms (linear)
+    float confidence;        // 0 (unusable) to 1 (clean, symmetric pulse)
+};
+
+void llv3_analyzeCorrelation      (const __s16 * record, __u16 count, LLv3_CorrResult * result);
+void llv3_analyzeCorrelationBatch (const __s16 * records, __u16 count, __u32 numRecords, LLv3_CorrResult * results);
+
+#endif
@@ -0,0 +1,123 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Streaming distance filters
+
+  Allocation-free filters for readDistance output, meant to run at the full
+  sensor rate. Windowed filters keep their samples in fixed-capacity arrays,
+  so the per-sample cost is bounded by LLv3_FILTER_WINDOW_MAX. Filters can be
+  chained with LLv3_FilterPipeline.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_filter_h
+#define LIDARLite_v3_filter_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Largest window supported by the windowed filters
+#define LLv3_FILTER_WINDOW_MAX 31
+
+// Largest number of stages in one pipeline
+#define LLv3_PIPELINE_MAX_STAGES 8
+
+// Common interface of all filter stages
+class LLv3_Filter
+{
+    public:
+        virtual           ~LLv3_Filter(void) {}
+        // Feed one value (cm) taken at 'timestamp' (ns), return the output
+        virtual float     update      (float value, __u64 timestamp) = 0;
+        virtual void      reset       (void) = 0;
+};
+
+// Running median over the last windowSize values
+class LLv3_MedianFilter : public LLv3_Filter
+{
+        float     window[LLv3_FILTER_WINDOW_MAX]; // Arrival order, circular
+        float     sorted[LLv3_FILTER_WINDOW_MAX]; // Same values, ascending
+        __u8      size;
+        __u8      count;
+        __u8      head;
+
+    public:
+                  LLv3_MedianFilter (__u8 windowSize = 5);
+        float     update      (float value, __u64 timestamp);
+        void      reset       (void);
+        float     median      (void);
+        __u8      getCount    (void);
+        const float * values  (void);
+};
+
+// Hampel identifier: a value further than 'threshold' scaled median absolute
+// deviations from the window median is replaced by the median
+class LLv3_HampelFilter : public LLv3_Filter
+{
+        LLv3_MedianFilter window;
+        float     threshold;
+        __u32     rejected;
+
+    public:
+                  LLv3_HampelFilter (__u8 windowSize = 7, float threshold = 3.0f);
+        float     update      (float value, __u64 timestamp);
+        void      reset       (void);
+        __u32     getRejected (void);
+};
+
+// Exponential moving average with smoothing factor alpha (0..1]
+class LLv3_EmaFilter : public LLv3_Filter
+{
+        float     alpha;
+        float     state;
+        __u8      primed;
+
+    public:
+                  LLv3_EmaFilter (float alpha = 0.2f);
+        float     update      (float value, __u64 timestamp);
+        void      reset       (void);
+};
+
+// Constant-velocity Kalman filter over [distance, velocity]
+class LLv3_KalmanFilter : public LLv3_Filter
+{
+        float     accelNoise;  // Process noise, (cm/s^2)^2
+        float     measNoise;   // Measurement variance, cm^2
+        float     x[2];        // Distance (cm), velocity (cm/s)
+        float     p[2][2];     // State covariance
+        __u64     lastStamp;
+        __u8      primed;
+
+    public:
+                  LLv3_KalmanFilter (float accelNoise = 10000.0f, float measNoise = 4.0f);
+        float     update      (float value, __u64 timestamp);
+        void      reset       (void);
+        float     velocity    (void);
+};
+
+// Runs a sample through a fixed sequence of caller-owned stages
+class LLv3_FilterPipeline
+{
+        LLv3_Filter * stages[LLv3_PIPELINE_MAX_STAGES];
+        __u8      numStages;
+        float     output;     // Last value returned, 0 before the first
+
+    public:
+                  LLv3_FilterPipeline (void);
+        __s32     addStage    (LLv3_Filter * stage);
+        float     update      (float value, __u64 timestamp);
+        float     update      (const LLv3_Sample * sample);
+        void      reset       (void);
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Multi-sensor frame assembly
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_frame_h
+#define LIDARLite_v3_frame_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Maximum number of sensors in one frame, and number of recent samples kept
+// per sensor to interpolate from
+#define LLv3_FRAME_MAX_SENSORS 16
+#define LLv3_FRAME_HISTORY     16
+
+// One reading of every sensor, aligned to a common time
+struct LLv3_Frame
+{
+    __u64 sequence;
+    __u64 timestamp;  // Common llv3_monotonicNs() time of all distances
+    __u64 spreadNs;   // Spread of the sensors' newest measurement times
+    __u8  numSensors;
+    __u8  addresses[LLv3_FRAME_MAX_SENSORS];
+    __u8  valid[LLv3_FRAME_MAX_SENSORS];     // 0 if no valid reading was near
+    float distance[LLv3_FRAME_MAX_SENSORS];  // cm, interpolated to 'timestamp'
+    __s64 offsetNs[LLv3_FRAME_MAX_SENSORS];  // Newest measurement time minus 'timestamp'
+};
+
+// Alignment statistics over all frames assembled so far
+struct LLv3_SkewStats
+{
+    __u64 frames;
+    __u64 maxSpreadNs;     // Largest spread of measurement times in one frame
+    double meanSpreadNs;
+    double meanDurationNs; // Mean trigger to completion time of the samples
+    __u64 extrapolated;    // Readings without samples on both sides of the frame time
+};
+
+/*------------------------------------------------------------------------------
+  LIDARLite_v3_FrameAssembler
+  Groups the samples of several sensors into frames. A frame is emitted once
+  every sensor has delivered a new sample. Its timestamp is the earliest of
+  the sensors' newest measurement times, and each sensor's distance is
+  linearly interpolated between its two samples around that time, so that
+  all distances in a frame refer to the same instant.
+
+  A sample's measurement time is the midpoint of its trigger and completion
+  timestamps, or its completion timestamp if the trigger time is unknown.
+------------------------------------------------------------------------------*/
+class LIDARLite_v3_FrameAssembler
+{
+        struct History
+        {
+            __u64 time[LLv3_FRAME_HISTORY];
+            float distance[LLv3_FRAME_HISTORY];
+            __u8  valid[LLv3_FRAME_HISTORY];
+            __u8  count;
+            __u8  newest;
+        };
+
+        __u8      addresses[LLv3_FRAME_MAX_SENSORS];
+        History   history[LLv3_FRAME_MAX_SENSORS];
+        __u8      numSensors;
+        __u32     fresh;      // Bit n set once sensor n delivered since the last frame
+        __u64     sequence;
+        __u64     frames;
+        __u64     maxSpreadNs;
+        __u64     extrapolated;
+        double    spreadSumNs;
+        double    durationSumNs;
+        __u64     durations;
+
+        void      interpolate (__u8 sensor, __u64 time, LLv3_Frame * frame);
+    public:
+                  LIDARLite_v3_FrameAssembler (void);
+        __s32     addSensor   (__u8 lidarliteAddress);
+        __s32     push        (const LLv3_Sample * sample, LLv3_Frame * frame);
+        void      getSkewStats (LLv3_SkewStats * stats);
+        void      reset       (void);
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Linux i2c-dev bus transport
+
+  Default transport for LIDARLite_v3: thin inline wrappers around the
+  /dev/i2c-N character device. Every transport provides the same set of
+  non-virtual methods; the one used is picked at compile time in
+  lidarlite_v3.h, so calls compile straight down to the system calls.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_i2cdev_h
+#define LIDARLite_v3_i2cdev_h
+
+#include <linux/types.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+
+class LLv3_I2cDevBus
+{
+        __s32     fd;
+        __u32     syscalls; // System calls issued through this bus
+
+    public:
+        LLv3_I2cDevBus(void) : fd(-1), syscalls(0) {}
+        ~LLv3_I2cDevBus(void) { close(); }
+
+        // Open /dev/i2c-<busNumber>. Returns 0 on success, -1 on failure.
+        __s32 open(__u8 busNumber)
+        {
+            char filename[20];
+
+            close();
+            snprintf(filename, sizeof(filename), "/dev/i2c-%u", busNumber);
+
+            syscalls++;
+            fd = ::open(filename, O_RDWR);
+
+            return (fd < 0) ? -1 : 0;
+        }
+
+        void close(void)
+        {
+            if (fd >= 0)
+            {
+                syscalls++;
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        // Bind the slave address used by write() and read()
+        __s32 setSlave(__u8 address)
+        {
+            syscalls++;
+            return ioctl(fd, I2C_SLAVE, address);
+        }
+
+        __s32 write(const __u8 * buffer, __u16 numBytes)
+        {
+            syscalls++;
+            return ::write(fd, buffer, numBytes);
+        }
+
+        __s32 read(__u8 * buffer, __u16 numBytes)
+        {
+            syscalls++;
+            return ::read(fd, buffer, numBytes);
+        }
+
+        // Combined transfer; each message carries its own slave address
+        __s32 transfer(struct i2c_msg * msgs, __u32 numMsgs)
+        {
+            struct i2c_rdwr_ioctl_data rdwr;
+
+            rdwr.msgs  = msgs;
+            rdwr.nmsgs = numMsgs;
+
+            syscalls++;
+            return ioctl(fd, I2C_RDWR, &rdwr);
+        }
+
+        __u32 getSyscalls(void) { return syscalls; }
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Parallel acquisition on several I2C buses
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_multibus_h
+#define LIDARLite_v3_multibus_h
+
+#include <linux/types.h>
+#include <atomic>
+#include <thread>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_ring.h>
+#include <include/lidarlite_v3_scheduler.h>
+
+// Maximum number of buses, and samples buffered per bus for the consumer
+#define LLv3_MULTIBUS_MAX_BUSES 8
+#define LLv3_MULTIBUS_RING_SIZE 1024
+
+/*------------------------------------------------------------------------------
+  LIDARLite_v3_MultiBus
+  Runs one acquisition thread per /dev/i2c-N bus. Each thread owns its own
+  LIDARLite_v3 and a LIDARLite_v3_Scheduler for the sensors on that bus, so
+  buses never wait on each other and throughput grows with the number of
+  buses. A thread can be pinned to a core and run under SCHED_FIFO.
+
+  Every bus feeds a single-producer ring; drain() takes from all of them in
+  turn, so the consumer sees one queue. Samples carry their bus number, as
+  sensors on different buses may share an address.
+------------------------------------------------------------------------------*/
+class LIDARLite_v3_MultiBus
+{
+        struct Worker
+        {
+            LIDARLite_v3           lidar;
+            LIDARLite_v3_Scheduler scheduler;
+            std::thread            thread;
+            __s32                  cpu;      // Core to pin to, -1 for any
+            __s32                  priority; // SCHED_FIFO priority, 0 for the default policy
+            std::atomic<__u32>     overruns;
+            std::atomic<__u64>     samples;
+            LLv3_Ring<LLv3_Sample, LLv3_MULTIBUS_RING_SIZE> ring;
+
+            Worker(void) : scheduler(&lidar), overruns(0), samples(0) {}
+        };
+
+        Worker *          workers[LLv3_MULTIBUS_MAX_BUSES];
+        __u8              numBuses;
+        __u8              nextBus;   // First bus drained by the next drain()
+        std::atomic<bool> running;
+
+        void      run         (Worker * worker);
+    public:
+                  LIDARLite_v3_MultiBus (void);
+                  ~LIDARLite_v3_MultiBus(void);
+        __s32     addBus      (__u8 busNumber, __s32 cpu = -1, __s32 fifoPriority = 0);
+        __s32     addSensor   (__u8 busIndex, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+        LIDARLite_v3 * getLidar (__u8 busIndex);
+        __u8      getBusCount (void);
+        __s32     start       (void);
+        void      stop        (void);
+        __u32     drain       (LLv3_Sample * samples, __u32 maxSamples);
+        __u64     getSampleCount (__u8 busIndex);
+        __u32     getOverruns (void);
+};
+
+#endif
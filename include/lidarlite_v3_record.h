@@ -0,0 +1,113 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Session recording and replay
+
+  A recording is an append-only binary log of register transactions and
+  decoded samples, laid out so it can be memory-mapped and walked in place:
+
+    File header   16 bytes: magic "LLv3REC", version byte, 8 reserved bytes
+    Record        16 byte LLv3_RecordHeader followed by 'length' payload
+                  bytes, padded with zeros to a multiple of 8 bytes
+
+  Payloads by record type
+  ------------------------------------------------------------------------------
+  LLv3_REC_WRITE:       bytes written starting at regAddr
+  LLv3_REC_READ:        bytes read starting at regAddr
+  LLv3_REC_SAMPLE:      one LLv3_Sample
+  LLv3_REC_CORRELATION: sign extended __s16 correlation values
+  LLv3_REC_SCAN:        LLv3_ScanRecord followed by the scan's x, y and z
+                        arrays, numPoints floats each
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_record_h
+#define LIDARLite_v3_record_h
+
+#include <linux/types.h>
+#include <stdio.h>
+
+#include <include/lidarlite_v3.h>
+
+#define LLv3_REC_MAGIC       "LLv3REC"
+#define LLv3_REC_VERSION     4
+#define LLv3_REC_HEADER_SIZE 16
+
+// Record types
+#define LLv3_REC_WRITE       1
+#define LLv3_REC_READ        2
+#define LLv3_REC_SAMPLE      3
+#define LLv3_REC_CORRELATION 4
+#define LLv3_REC_SCAN        5
+
+struct LLv3_RecordHeader
+{
+    __u64 timestamp; // llv3_monotonicNs() time of the transaction
+    __u8  type;      // LLv3_REC_*
+    __u8  address;   // I2C device address
+    __u8  regAddr;   // Register address, 0 for decoded records
+    __u8  failed;    // Non-zero if the transfer reported an error
+    __u16 length;    // Payload length in bytes, before padding
+    __u16 reserved;
+};
+
+// Leads the payload of an LLv3_REC_SCAN record
+struct LLv3_ScanRecord
+{
+    __u64 sequence;
+    __u64 startTime;
+    __u64 endTime;
+    __u32 numPoints;
+    __u32 dropped;
+};
+
+struct LLv3_ScanFrame;
+
+class LIDARLite_v3_Recorder
+{
+        FILE *    file;
+
+    public:
+                  LIDARLite_v3_Recorder (void);
+                  ~LIDARLite_v3_Recorder(void);
+        __s32     open        (const char * path);
+        void      close       (void);
+        void      logTransfer (__u8 type, __u8 address, __u8 regAddr,
+                               const __u8 * dataBytes, __u16 numBytes, __u8 failed);
+        void      logSample   (const LLv3_Sample * sample);
+        void      logCorrelation (__u8 address, const __s16 * values, __u16 count);
+        void      logScan     (const LLv3_ScanFrame * frame);
+};
+
+class LIDARLite_v3_Replay
+{
+        const __u8 * base;
+        __u64     size;
+        __u64     cursor;     // Offset of the next record to examine
+        __u8      realtime;
+        __u64     firstStamp; // Timestamp of the first record
+        __u64     startTime;  // Local time replay began, 0 until first read
+
+        void      pace        (__u64 timestamp);
+    public:
+                  LIDARLite_v3_Replay (void);
+                  ~LIDARLite_v3_Replay(void);
+        __s32     open        (const char * path);
+        void      close       (void);
+        void      rewind      (void);
+        void      setRealtime (__u8 enable);
+        const LLv3_RecordHeader * next (const __u8 ** payload);
+        __s32     read        (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress);
+        __s32     write       (__u8 regAddr, __u8 * dataBytes, __u8 numBytes, __u8 lidarliteAddress);
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Single-producer / single-consumer lock-free ring buffer
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_ring_h
+#define LIDARLite_v3_ring_h
+
+#include <linux/types.h>
+#include <atomic>
+
+/*------------------------------------------------------------------------------
+  LLv3_Ring
+  Fixed-capacity ring for exactly one producer thread and one consumer thread.
+  The producer only writes 'head' and the consumer only writes 'tail', so no
+  locks are needed. Both indices run freely and are masked on access, which
+  requires the capacity to be a power of two.
+------------------------------------------------------------------------------*/
+template <typename T, __u32 capacity>
+class LLv3_Ring
+{
+        static_assert((capacity & (capacity - 1)) == 0,
+                      "LLv3_Ring capacity must be a power of two");
+
+        T slots[capacity];
+
+        // Keep the indices on separate cache lines to avoid false sharing
+        alignas(64) std::atomic<__u32> head;
+        alignas(64) std::atomic<__u32> tail;
+
+    public:
+        LLv3_Ring(void) : head(0), tail(0) {}
+
+        // Producer side. Returns false, leaving the ring untouched, when full.
+        bool push(const T & item)
+        {
+            __u32 h = head.load(std::memory_order_relaxed);
+
+            if (h - tail.load(std::memory_order_acquire) == capacity)
+                return false;
+
+            slots[h & (capacity - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Consumer side. Copies up to maxItems into 'items', returns the count.
+        __u32 pop(T * items, __u32 maxItems)
+        {
+            __u32 t = tail.load(std::memory_order_relaxed);
+            __u32 n = head.load(std::memory_order_acquire) - t;
+            __u32 i;
+
+            if (n > maxItems)
+                n = maxItems;
+
+            for (i=0 ; i<n ; i++)
+                items[i] = slots[(t + i) & (capacity - 1)];
+
+            tail.store(t + n, std::memory_order_release);
+
+            return n;
+        }
+
+        // Number of items waiting. Exact only when called from one of the
+        // two owning threads while the other is idle.
+        __u32 size(void)
+        {
+            return head.load(std::memory_order_acquire) -
+                   tail.load(std::memory_order_acquire);
+        }
+};
+
+#endif
@@ -0,0 +1,48 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Multi-sensor scheduler
+
+  Pipelines measurements across several LIDAR-Lites on one I2C bus: every
+  sensor is triggered up front and each one is harvested and re-triggered as
+  soon as it reports not busy, so acquisition windows overlap.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_scheduler_h
+#define LIDARLite_v3_scheduler_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Maximum number of sensors handled by one scheduler
+#define LLv3_SCHED_MAX_SENSORS 16
+
+class LIDARLite_v3_Scheduler
+{
+        LIDARLite_v3 * lidar;
+        __u8      addresses[LLv3_SCHED_MAX_SENSORS];
+        __u64     triggerNs[LLv3_SCHED_MAX_SENSORS]; // When each was last triggered
+        __u64     busyNs[LLv3_SCHED_MAX_SENSORS];    // Last time each was seen busy
+        __u8      numSensors;
+        __u8      nextSensor; // First sensor checked by the next poll()
+
+    public:
+                  LIDARLite_v3_Scheduler (LIDARLite_v3 * lidarlite);
+        __s32     addSensor   (__u8 lidarliteAddress);
+        __u8      getSensorCount (void);
+        void      start       (void);
+        __u32     poll        (LLv3_Sample * samples, __u32 maxSamples);
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Simulated bus transport and LIDAR-Lite v3 register model
+
+  Build with -DLLv3_TRANSPORT_SIM to run LIDARLite_v3 against an in-process
+  model of one or more LIDAR-Lites instead of /dev/i2c-N. The model covers:
+    - the busy flag, held for the acquisition time of the active
+      SIG_CNT_VAL / REF_CNT_VAL / ACQ_CONFIG settings (see llv3_acqTimeUs),
+      and the mode pin in status output mode following it
+    - the distance registers, updated when a measurement completes
+    - return signal strength falling with the square of the distance and
+      growing with SIG_CNT_VAL; below a detection limit STATUS reports no
+      valid signal, and optional distance noise grows as the signal fades
+    - UNIT_ID and the I2C_ID / I2C_SEC_ADR / I2C_CONFIG secondary address flow
+    - the correlation memory bank read through test mode
+    - optional byte timing at a given I2C clock rate, spun or slept through
+
+  Each simulated bus number has one shared LLv3_SimModel, like a physical
+  bus: every LLv3_SimBus opened on that number sees the same devices. Test
+  code sets up devices through LLv3_SimModel::get(busNumber).
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_sim_h
+#define LIDARLite_v3_sim_h
+
+#include <linux/types.h>
+#include <linux/i2c.h>
+#include <mutex>
+
+// Limits of the model
+#define LLv3_SIM_MAX_BUSES   8
+#define LLv3_SIM_MAX_DEVICES 16
+#define LLv3_SIM_CORR_SIZE   1024
+
+// Return signal model: a device with SIG_CNT_VAL at 0xff just detects a
+// target at LLv3_SIM_MAX_RANGE_CM, where its SIGNAL_STRENGTH reads
+// LLv3_SIM_SIGNAL_MIN. Range grows with the square root of the count.
+#define LLv3_SIM_MAX_RANGE_CM 4000
+#define LLv3_SIM_SIGNAL_MIN   24
+
+// State of one simulated LIDAR-Lite
+struct LLv3_SimDevice
+{
+    __u8      regs[256];
+    __u8      regPointer;
+    __u8      autoIncrement;
+    __u16     unitId;
+    __u8      secondaryAddress;  // Accepted I2C_SEC_ADR value, 0 if none
+    __u8      secondaryEnabled;
+    __u8      defaultDisabled;
+    __u8      testMode;
+    __u16     corrIndex;
+    __u64     busyUntil;         // llv3_monotonicNs() time the measurement ends
+    __u8      pending;           // A measurement result has not been published
+    __u16     distance;          // Simulated target distance in cm
+    float     noiseCm;           // Distance noise at the detection limit
+    __u32     noiseState;        // Random number generator state
+};
+
+class LLv3_SimModel
+{
+        std::mutex      lock;          // Held for a whole transfer, like a bus
+        LLv3_SimDevice  devices[LLv3_SIM_MAX_DEVICES];
+        __u8            numDevices;
+        __u32           busClockHz;    // 0 = transfers take no bus time
+        __u64           busFreeAt;     // llv3_monotonicNs() time the last transfer ends
+        __u8            busSleep;      // Sleep rather than spin through bus time
+
+        LLv3_SimDevice * find      (__u8 address);
+        void             update    (LLv3_SimDevice * device);
+        void             writeReg  (LLv3_SimDevice * device, __u8 regAddr, __u8 value);
+        __u8             readReg   (LLv3_SimDevice * device, __u8 regAddr);
+        void             resetDevice (LLv3_SimDevice * device);
+    public:
+                  LLv3_SimModel (void);
+        static LLv3_SimModel * get (__u8 busNumber);
+
+        __s32     addDevice   (__u8 address, __u16 unitId);
+        void      removeAll   (void);
+        void      setDistance (__u8 address, __u16 distance);
+        void      setNoise    (__u8 address, float noiseCm);
+        void      setBusClock (__u32 hz);
+        void      setBusSleep (__u8 enable);
+        void      powerCycle  (__u8 address);
+        __s32     waitModePin (__u8 address, __u64 deadline);
+        __s32     transfer    (struct i2c_msg * msgs, __u32 numMsgs);
+};
+
+class LLv3_SimBus
+{
+        LLv3_SimModel * model;
+        __u8      slave;    // Address bound by setSlave
+        __u32     syscalls; // Equivalent i2c-dev system calls issued
+
+    public:
+                  LLv3_SimBus (void);
+        __s32     open        (__u8 busNumber);
+        void      close       (void);
+        __s32     setSlave    (__u8 address);
+        __s32     write       (const __u8 * buffer, __u16 numBytes);
+        __s32     read        (__u8 * buffer, __u16 numBytes);
+        __s32     transfer    (struct i2c_msg * msgs, __u32 numMsgs);
+        __u32     getSyscalls (void);
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Transfer instrumentation: counters, latency histograms and an error trace
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_stats_h
+#define LIDARLite_v3_stats_h
+
+#include <linux/types.h>
+#include <atomic>
+
+// Build with -DLLv3_USDT to emit a static tracepoint for every bus
+// operation (provider "llv3", probe "xfer"): op, reg, address, ns, errno
+#ifdef LLv3_USDT
+#include <sys/sdt.h>
+#define LLv3_TRACE_XFER(op, reg, addr, ns, err) \
+    DTRACE_PROBE5(llv3, xfer, op, reg, addr, ns, err)
+#else
+#define LLv3_TRACE_XFER(op, reg, addr, ns, err)
+#endif
+
+// Operation types
+#define LLv3_OP_READ          0 // Register read on the bus
+#define LLv3_OP_WRITE         1 // Register write with write() (legacy mode)
+#define LLv3_OP_BATCH         2 // Queued writes submitted with ioctl(I2C_RDWR)
+#define LLv3_OP_BIND          3 // ioctl(I2C_SLAVE)
+#define LLv3_OP_RECOVER       4 // Bus reopen and device reconfiguration
+#define LLv3_NUM_OPS          5
+
+#define LLv3_STATS_NUM_REGS   128 // Register address without the auto-increment bit
+#define LLv3_STATS_HIST_BINS  32  // Bin n counts latencies in [2^n, 2^(n+1)) ns
+#define LLv3_STATS_ERROR_RING 64  // Must be a power of two
+
+struct LLv3_StatsError
+{
+    __u64 timestamp; // llv3_monotonicNs() when the failure was seen
+    __s32 error;     // errno
+    __u8  op;        // LLv3_OP_*
+    __u8  regAddr;
+    __u8  address;   // Device address
+};
+
+// Plain copy of the counters, see LLv3_Stats::snapshot
+struct LLv3_StatsSnapshot
+{
+    __u64 regReads[LLv3_STATS_NUM_REGS];
+    __u64 regWrites[LLv3_STATS_NUM_REGS];
+    __u64 ops[LLv3_NUM_OPS];
+    __u64 failures[LLv3_NUM_OPS];
+    __u64 latencyNs[LLv3_NUM_OPS];
+    __u64 histogram[LLv3_NUM_OPS][LLv3_STATS_HIST_BINS];
+    __u64 retries;    // Repeated measure() attempts
+    __u64 errorsTotal;
+    __u32 numErrors;  // Entries valid in 'errors', oldest first
+    LLv3_StatsError errors[LLv3_STATS_ERROR_RING];
+};
+
+/*------------------------------------------------------------------------------
+  LLv3_Stats
+  Always-on instrumentation owned by one LIDARLite_v3 instance. Only the
+  thread using that instance updates it, so counters are bumped with a
+  relaxed load and store rather than a locked read-modify-write; the cost is
+  a few plain instructions per call. Any thread may call snapshot().
+------------------------------------------------------------------------------*/
+class LLv3_Stats
+{
+        typedef std::atomic<__u64> Counter;
+
+        Counter   regReads[LLv3_STATS_NUM_REGS];
+        Counter   regWrites[LLv3_STATS_NUM_REGS];
+        Counter   ops[LLv3_NUM_OPS];
+        Counter   failures[LLv3_NUM_OPS];
+        Counter   latencyNs[LLv3_NUM_OPS];
+        Counter   histogram[LLv3_NUM_OPS][LLv3_STATS_HIST_BINS];
+        Counter   retries;
+        Counter   errorHead;
+        LLv3_StatsError errors[LLv3_STATS_ERROR_RING];
+
+        static void bump(Counter & counter, __u64 amount = 1)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount,
+                          std::memory_order_relaxed);
+        }
+
+    public:
+                  LLv3_Stats(void);
+        void      reset       (void);
+        void      snapshot    (LLv3_StatsSnapshot * out) const;
+
+        // Count a register access requested by the caller, including ones
+        // answered by the register shadow
+        void      countRead   (__u8 regAddr, __u8 numBytes)
+        {
+            bump(regReads[regAddr & (LLv3_STATS_NUM_REGS - 1)], numBytes);
+        }
+
+        void      countWrite  (__u8 regAddr, __u8 numBytes)
+        {
+            bump(regWrites[regAddr & (LLv3_STATS_NUM_REGS - 1)], numBytes);
+        }
+
+        // Account one bus operation that took 'ns' nanoseconds
+        void      recordOp    (__u8 op, __u64 ns, __u8 failed)
+        {
+            __u32 bin = (ns > 1) ? 63 - __builtin_clzll(ns) : 0;
+
+            if (bin >= LLv3_STATS_HIST_BINS)
+                bin = LLv3_STATS_HIST_BINS - 1;
+
+            bump(ops[op]);
+            bump(latencyNs[op], ns);
+            bump(histogram[op][bin]);
+
+            if (failed)
+                bump(failures[op]);
+        }
+
+        void      countRetry  (void)
+        {
+            bump(retries);
+        }
+
+        void      recordError (__u8 op, __u8 regAddr, __u8 address, __s32 error, __u64 timestamp);
+};
+
+// Latency below which the given fraction (0..1) of operations completed,
+// as the upper edge of the matching histogram bin. 0 if nothing was counted.
+__u64 llv3_statsPercentileNs(const LLv3_StatsSnapshot * snap, __u8 op, double fraction);
+
+#endif
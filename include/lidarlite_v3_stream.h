@@ -0,0 +1,52 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Continuous ranging engine
+
+  A background thread keeps one LIDAR-Lite ranging back to back and pushes
+  timestamped samples into a lock-free ring that the caller drains in batches.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_stream_h
+#define LIDARLite_v3_stream_h
+
+#include <linux/types.h>
+#include <atomic>
+#include <thread>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_ring.h>
+
+// Number of samples buffered between the acquisition thread and the consumer
+#define LLv3_STREAM_RING_SIZE 1024
+
+class LIDARLite_v3_Stream
+{
+        LIDARLite_v3 *    lidar;
+        __u8              address;
+        std::thread       worker;
+        std::atomic<bool> running;
+        std::atomic<__u32> overruns;
+        LLv3_Ring<LLv3_Sample, LLv3_STREAM_RING_SIZE> ring;
+
+        void      run         (void);
+    public:
+                  LIDARLite_v3_Stream (LIDARLite_v3 * lidarlite, __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+                  ~LIDARLite_v3_Stream(void);
+        __s32     start       (void);
+        void      stop        (void);
+        __u32     drain       (LLv3_Sample * samples, __u32 maxSamples);
+        __u32     getOverruns (void);
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Point cloud sweeps with a pan/tilt scanned sensor
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#ifndef LIDARLite_v3_sweep_h
+#define LIDARLite_v3_sweep_h
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3.h>
+
+// Points per scan frame, and number of frames in a sweep engine's pool
+#define LLv3_SCAN_MAX_POINTS 4096
+#define LLv3_SCAN_POOL_SIZE  4
+
+// One scan as structure-of-arrays. Angles are in radians: pan turns about
+// the z axis starting from x, tilt raises the beam towards z. Coordinates
+// and ranges are in metres.
+struct LLv3_ScanFrame
+{
+    __u64 sequence;
+    __u64 startTime;  // llv3_monotonicNs() time of the first point
+    __u64 endTime;    // and of the last
+    __u32 numPoints;
+    __u32 dropped;    // Samples left out as invalid or without a return
+    __u8  address;    // I2C device address of the sensor
+
+    alignas(32) float x[LLv3_SCAN_MAX_POINTS];
+    alignas(32) float y[LLv3_SCAN_MAX_POINTS];
+    alignas(32) float z[LLv3_SCAN_MAX_POINTS];
+    alignas(32) float range[LLv3_SCAN_MAX_POINTS];
+    alignas(32) float pan[LLv3_SCAN_MAX_POINTS];
+    alignas(32) float tilt[LLv3_SCAN_MAX_POINTS];
+    __u64 timestamp[LLv3_SCAN_MAX_POINTS];
+};
+
+// Returns the stage angles at a llv3_monotonicNs() time, e.g. by
+// interpolating the servo command history or reading an encoder
+typedef void (*LLv3_AngleSource)(__u64 timestamp, float * pan, float * tilt, void * context);
+
+/*------------------------------------------------------------------------------
+  LIDARLite_v3_Sweep
+  Collects samples into scan frames taken from a pool allocated once at
+  construction. begin() takes a free frame, step() or addSample() append
+  points paired with the angles at their measurement time, and end() converts
+  the whole frame to Cartesian coordinates in one batch and hands it to the
+  caller, who returns it with release() when done.
+------------------------------------------------------------------------------*/
+class LIDARLite_v3_Sweep
+{
+        LIDARLite_v3 *   lidar;
+        LLv3_AngleSource angleSource;
+        void *           angleContext;
+        __u8             address;
+        LLv3_ScanFrame * pool;
+        __u8             inUse[LLv3_SCAN_POOL_SIZE];
+        LLv3_ScanFrame * current;
+        __u64            sequence;
+
+    public:
+                  LIDARLite_v3_Sweep (LIDARLite_v3 * lidarlite, LLv3_AngleSource source, void * context,
+                                      __u8 lidarliteAddress = LIDARLITE_ADDR_DEFAULT);
+                  ~LIDARLite_v3_Sweep(void);
+        __s32     begin       (void);
+        __s32     step        (void);
+        __s32     addSample   (const LLv3_Sample * sample);
+        LLv3_ScanFrame * end  (void);
+        void      release     (LLv3_ScanFrame * frame);
+};
+
+// Convert 'count' polar points to Cartesian coordinates. All arrays may be
+// unaligned; 32-byte alignment, as in LLv3_ScanFrame, is fastest.
+void  llv3_polarToCartesian (const float * range, const float * pan, const float * tilt,
+                             float * x, float * y, float * z, __u32 count);
+
+// Polynomial sine and cosine used by llv3_polarToCartesian, accurate to a
+// few units in the last place for |angle| up to several thousand radians
+void  llv3_sincos (float angle, float * sine, float * cosine);
+
+// Write a frame as a binary PCD (Point Cloud Library) file with fields
+// x y z range. Returns 0 on success or -1 on failure.
+__s32 llv3_writePcd (const char * path, const LLv3_ScanFrame * frame);
+
+#endif
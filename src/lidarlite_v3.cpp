@@ -18,26 +18,117 @@
 ------------------------------------------------------------------------------*/
 
 #include <linux/types.h>
-#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <linux/gpio.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#endif
 
 #include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_record.h>
+
+/*------------------------------------------------------------------------------
+  Monotonic Time
+  Return the current CLOCK_MONOTONIC_RAW time in nanoseconds. All library
+  timestamps and deadlines use this clock.
+------------------------------------------------------------------------------*/
+__u64 llv3_monotonicNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+    return ((__u64) now.tv_sec * 1000000000ull) + now.tv_nsec;
+}
+
+/*------------------------------------------------------------------------------
+  Sleep
+  Sleep for the given number of microseconds
+------------------------------------------------------------------------------*/
+static void llv3_sleepUs(__u32 us)
+{
+    struct timespec delay;
+
+    delay.tv_sec  = us / 1000000;
+    delay.tv_nsec = (us % 1000000) * 1000;
+
+    nanosleep(&delay, NULL);
+}
+
+/*------------------------------------------------------------------------------
+  Constructor
+  Defaults to the original write()/read() transfer mode with no batch pending
+  and to spinning on the busy flag without a timeout.
+------------------------------------------------------------------------------*/
+LIDARLite_v3::LIDARLite_v3(void)
+{
+    boundAddress     = -1;
+    slaveBindCount   = 0;
+    slaveBindSkipped = 0;
+    xferMode         = LLv3_XFER_READWRITE;
+    waitPolicy       = LLv3_WAIT_SPIN;
+    waitTimeoutUs    = 0;
+    gpioFd           = -1;
+    gpioBusyLevel    = 1;
+    lastStatus       = 0;
+    memset(shadows, 0, sizeof(shadows));
+    shadowHits       = 0;
+    shadowMisses     = 0;
+    memset(setups, 0, sizeof(setups));
+    busNumber        = 1;
+    retryMax         = LLv3_RETRY_MAX_DEFAULT;
+    retryBackoffUs   = LLv3_RETRY_BACKOFF_US;
+    deadlineUs       = 0;
+    recorder         = NULL;
+    replay           = NULL;
+    batchDepth       = 0;
+    batchCount       = 0;
+}
+
+/*------------------------------------------------------------------------------
+  Destructor
+  Release the mode pin line if one was requested with gpioInit
+------------------------------------------------------------------------------*/
+LIDARLite_v3::~LIDARLite_v3(void)
+{
+#ifndef LLv3_TRANSPORT_SIM
+    if (gpioFd >= 0)
+        close(gpioFd);
+#endif
+}
 
 /*------------------------------------------------------------------------------
   I2C Init
   Initialize the I2C peripheral in the processor core
+
+  Parameters
+  ------------------------------------------------------------------------------
+  busNumber: Default 1, for /dev/i2c-1 on the Raspberry Pi 40-pin header.
 ------------------------------------------------------------------------------*/
-__s32 LIDARLite_v3::i2c_init (void)
+__s32 LIDARLite_v3::i2c_init (__u8 busNumber)
 {
-    char *filename = (char*)"/dev/i2c-1";
+    // A fresh file descriptor has no slave address bound yet
+    boundAddress = -1;
 
-    if ((file_i2c = open(filename, O_RDWR)) < 0)
+    // Remembered for recover()
+    this->busNumber = busNumber;
+
+    if (bus.open(busNumber) < 0)
     {
         //ERROR HANDLING: you can check errno to see what went wrong
-        printf("Failed to open the i2c bus");
+        printf("Failed to open the i2c bus: %s\n", strerror(errno));
         return -1;
     }
     else
@@ -46,9 +137,20 @@ __s32 LIDARLite_v3::i2c_init (void)
     }
 }
 
+/*------------------------------------------------------------------------------
+  Get Bus Number
+  Number N of the /dev/i2c-N bus last opened by i2c_init
+------------------------------------------------------------------------------*/
+__u8 LIDARLite_v3::getBusNumber(void)
+{
+    return busNumber;
+} /* LIDARLite_v3::getBusNumber */
+
 /*------------------------------------------------------------------------------
   I2C Connect
-  Connect to the I2C device with the specified device address
+  Connect to the I2C device with the specified device address. The address
+  bound to the file descriptor is remembered, and the ioctl(I2C_SLAVE) is
+  skipped when the requested address is already bound.
 
   Parameters
   ------------------------------------------------------------------------------
@@ -57,18 +159,88 @@ __s32 LIDARLite_v3::i2c_init (void)
 ------------------------------------------------------------------------------*/
 __s32 LIDARLite_v3::i2c_connect (__u8 lidarliteAddress)
 {
-    if (ioctl(file_i2c, I2C_SLAVE, lidarliteAddress) < 0)
+    __u64 start;
+    __s32 result;
+
+    if (boundAddress == lidarliteAddress)
+    {
+        slaveBindSkipped++;
+        return 0;
+    }
+
+    slaveBindCount++;
+
+    start  = llv3_monotonicNs();
+    result = bus.setSlave(lidarliteAddress);
+    statsOp(LLv3_OP_BIND, start, (result < 0), 0, lidarliteAddress);
+
+    if (result < 0)
     {
-        printf("Failed to acquire bus access and/or talk to slave.\n");
+        boundAddress = -1;
+        printf("Failed to acquire bus access and/or talk to slave: %s\n", strerror(errno));
         //ERROR HANDLING; you can check errno to see what went wrong
         return -1;
     }
     else
     {
+        boundAddress = lidarliteAddress;
         return 0;
     }
 }
 
+/*------------------------------------------------------------------------------
+  Get Bus
+  Access the bus transport, e.g. for its system call counter
+------------------------------------------------------------------------------*/
+LLv3_Bus * LIDARLite_v3::getBus(void)
+{
+    return &bus;
+}
+
+/*------------------------------------------------------------------------------
+  Slave Bind Counters
+  getSlaveBindCount returns the number of ioctl(I2C_SLAVE) calls issued.
+  getSlaveBindSkipped returns the number of calls saved because the requested
+  address was already bound to the file descriptor.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3::getSlaveBindCount(void)
+{
+    return slaveBindCount;
+}
+
+__u32 LIDARLite_v3::getSlaveBindSkipped(void)
+{
+    return slaveBindSkipped;
+}
+
+/*------------------------------------------------------------------------------
+  Get Stats
+  Access the transfer counters, latency histograms and error trace. Take a
+  snapshot() to read them from another thread.
+------------------------------------------------------------------------------*/
+LLv3_Stats * LIDARLite_v3::getStats(void)
+{
+    return &stats;
+}
+
+/*------------------------------------------------------------------------------
+  Stats Op
+  Account one finished bus operation that started at 'startNs'. Failures are
+  added to the error trace along with the current errno.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::statsOp(__u8 op, __u64 startNs, __u8 failed,
+                           __u8 regAddr, __u8 lidarliteAddress)
+{
+    __s32 error = errno;
+    __u64 now   = llv3_monotonicNs();
+
+    stats.recordOp(op, now - startNs, failed);
+    LLv3_TRACE_XFER(op, regAddr, lidarliteAddress, now - startNs, failed ? error : 0);
+
+    if (failed)
+        stats.recordError(op, regAddr, lidarliteAddress, error, now);
+} /* LIDARLite_v3::statsOp */
+
 /*------------------------------------------------------------------------------
   Configure
   Selects one of several preset configurations.
@@ -86,80 +258,254 @@ __s32 LIDARLite_v3::i2c_connect (__u8 lidarliteAddress)
         algorithm, and uses a threshold value for high sensitivity and noise.
     5: Low sensitivity detection. Overrides default valid measurement detection
         algorithm, and uses a threshold value for low sensitivity and noise.
+    6: Short range, high speed, higher error. Uses 0x04 maximum acquisition
+        count and puts the mode pin in status output mode.
+    Any other value selects 0. The register values are in LLv3_PRESETS; use
+    configure<N>() to pick a preset at compile time.
   lidarliteAddress: Default 0x62. Fill in new address here if changed. See
     operating manual for instructions.
 ------------------------------------------------------------------------------*/
 void LIDARLite_v3::configure(__u8 configuration, __u8 lidarliteAddress)
 {
-    __u8 sigCountMax;
-    __u8 acqConfigReg;
-    __u8 refCountMax;
-    __u8 thresholdBypass;
+    if (configuration >= LLv3_NUM_PRESETS)
+        configuration = 0; // Default mode, balanced performance
+
+    configure(LLv3_PRESETS[configuration], lidarliteAddress);
+} /* LIDARLite_v3::configure */
+
+/*------------------------------------------------------------------------------
+  Configure (custom preset)
+  Apply a built-in or user-defined preset. Registers that already hold the
+  requested value are skipped by the register shadow (see i2cWrite), so
+  switching between presets costs one write per changed register.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  preset: register values to apply
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::configure(const LLv3_Preset & preset, __u8 lidarliteAddress)
+{
+    LLv3_Preset values = preset;
+    LLv3_DeviceSetup * setup = setupFor(lidarliteAddress, 1);
 
-    switch (configuration)
+    // Remembered so recover() can apply it again after a power loss, and
+    // for the worst case measurement time used by LLv3_WAIT_PREDICT
+    if (setup)
     {
-        case 0: // Default mode, balanced performance
-            sigCountMax     = 0x80; // Default
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x05; // Default
-            thresholdBypass = 0x00; // Default
-            break;
+        setup->hasPreset = 1;
+        setup->preset    = preset;
+    }
 
-        case 1: // Short range, high speed
-            sigCountMax     = 0x1d;
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x03;
-            thresholdBypass = 0x00; // Default
-            break;
+    // In LLv3_XFER_RDWR mode the changed registers go out in one ioctl
+    beginBatch();
+    i2cWrite(LLv3_SIG_CNT_VAL,   &values.sigCountMax    , 1, lidarliteAddress);
+    i2cWrite(LLv3_ACQ_CONFIG,    &values.acqConfigReg   , 1, lidarliteAddress);
+    i2cWrite(LLv3_REF_CNT_VAL,   &values.refCountMax    , 1, lidarliteAddress);
+    i2cWrite(LLv3_THRESH_BYPASS, &values.thresholdBypass, 1, lidarliteAddress);
+    endBatch();
+} /* LIDARLite_v3::configure */
 
-        case 2: // Default range, higher speed short range
-            sigCountMax     = 0x80; // Default
-            acqConfigReg    = 0x00;
-            refCountMax     = 0x03;
-            thresholdBypass = 0x00; // Default
-            break;
+/*------------------------------------------------------------------------------
+  Register Shadow
+  A host-side copy of each device's configuration and identity registers.
+  Writes go through to the device and update the copy; a write of values the
+  copy already holds is suppressed, and reads of known registers (the
+  UNIT_ID serial number, for example) are answered from the copy. Registers
+  the device changes on its own (STATUS, DISTANCE, ...) or whose writes are
+  commands (ACQ_CMD, COMMAND) are never shadowed, and neither are the I2C
+  addressing registers: they act on whichever unit answers the address at
+  the time, and a unit powering up at 0x62 must always receive them.
+------------------------------------------------------------------------------*/
 
-        case 3: // Maximum range
-            sigCountMax     = 0xff;
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x05; // Default
-            thresholdBypass = 0x00; // Default
-            break;
+// Position of a register in LLv3_Shadow::values, or -1 if not shadowed
+static __s8 llv3_shadowIndex(__u8 regAddr)
+{
+    switch (regAddr)
+    {
+        case LLv3_SIG_CNT_VAL:   return 0;
+        case LLv3_ACQ_CONFIG:    return 1;
+        case LLv3_REF_CNT_VAL:   return 2;
+        case LLv3_UNIT_ID_HIGH:  return 3;
+        case LLv3_UNIT_ID_LOW:   return 4;
+        case LLv3_THRESH_BYPASS: return 5;
+        case LLv3_ACQ_SETTINGS:  return 6;
+        default:                 return -1;
+    }
+}
 
-        case 4: // High sensitivity detection, high erroneous measurements
-            sigCountMax     = 0x80; // Default
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x05; // Default
-            thresholdBypass = 0x80;
-            break;
+// Shadow entries of UNIT_ID, which survive a device reset
+#define LLv3_SHADOW_IDENTITY ((1 << 3) | (1 << 4))
 
-        case 5: // Low sensitivity detection, low erroneous measurements
-            sigCountMax     = 0x80; // Default
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x05; // Default
-            thresholdBypass = 0xb0;
-            break;
+/*------------------------------------------------------------------------------
+  Shadow For
+  Find the shadow of a device, allocating a free entry if 'create' is set.
+  Returns NULL if the device has no entry (and none is free).
+------------------------------------------------------------------------------*/
+LLv3_Shadow * LIDARLite_v3::shadowFor(__u8 lidarliteAddress, __u8 create)
+{
+    __u8 i;
 
-        case 6: // Short range, high speed, higher error
-            sigCountMax     = 0x04;
-            acqConfigReg    = 0x01; // turn off short_sig, mode pin = status output mode
-            refCountMax     = 0x03;
-            thresholdBypass = 0x00;
-            break;
+    for (i=0 ; i<LLv3_SHADOW_MAX_DEVICES ; i++)
+    {
+        if (shadows[i].used && shadows[i].address == lidarliteAddress)
+            return &shadows[i];
+    }
 
-        default: // Default mode, balanced performance - same as configure(0)
-            sigCountMax     = 0x80; // Default
-            acqConfigReg    = 0x08; // Default
-            refCountMax     = 0x05; // Default
-            thresholdBypass = 0x00; // Default
-            break;
+    if (!create)
+        return NULL;
+
+    for (i=0 ; i<LLv3_SHADOW_MAX_DEVICES ; i++)
+    {
+        if (!shadows[i].used)
+        {
+            shadows[i].used    = 1;
+            shadows[i].address = lidarliteAddress;
+            shadows[i].valid   = 0;
+            return &shadows[i];
+        }
     }
 
-    i2cWrite(LLv3_SIG_CNT_VAL,   &sigCountMax    , 1, lidarliteAddress);
-    i2cWrite(LLv3_ACQ_CONFIG,    &acqConfigReg   , 1, lidarliteAddress);
-    i2cWrite(LLv3_REF_CNT_VAL,   &refCountMax    , 1, lidarliteAddress);
-    i2cWrite(LLv3_THRESH_BYPASS, &thresholdBypass, 1, lidarliteAddress);
-} /* LIDARLite_v3::configure */
+    return NULL;
+} /* LIDARLite_v3::shadowFor */
+
+/*------------------------------------------------------------------------------
+  Shadow Lookup
+  Check whether a transfer of numBytes consecutive registers starting at
+  regAddr can be served from the shadow. For a write, every register must
+  be known and already hold the value in dataBytes; for a read, every
+  register must be known and its value is copied into dataBytes.
+
+  Returns 1 on a hit, 0 on a miss, or -1 if any register is not shadowed.
+------------------------------------------------------------------------------*/
+__s8 LIDARLite_v3::shadowLookup(__u8 regAddr, __u8 * dataBytes, __u8 numBytes,
+                                __u8 lidarliteAddress, __u8 isWrite)
+{
+    LLv3_Shadow * shadow;
+    __u8  hit = 1;
+    __s8  index;
+    __u8  i;
+
+    for (i=0 ; i<numBytes ; i++)
+    {
+        if (llv3_shadowIndex((regAddr & 0x7f) + i) < 0)
+            return -1;
+    }
+
+    if ((shadow = shadowFor(lidarliteAddress, 0)) == NULL)
+        hit = 0;
+
+    for (i=0 ; i<numBytes && hit ; i++)
+    {
+        index = llv3_shadowIndex((regAddr & 0x7f) + i);
+
+        if (!(shadow->valid & (1 << index)))
+            hit = 0;
+        else if (isWrite && shadow->values[index] != dataBytes[i])
+            hit = 0;
+    }
+
+    if (!hit)
+    {
+        shadowMisses++;
+        return 0;
+    }
+
+    if (!isWrite)
+    {
+        for (i=0 ; i<numBytes ; i++)
+            dataBytes[i] = shadow->values[llv3_shadowIndex((regAddr & 0x7f) + i)];
+    }
+
+    shadowHits++;
+    return 1;
+} /* LIDARLite_v3::shadowLookup */
+
+/*------------------------------------------------------------------------------
+  Shadow Store
+  Record the outcome of a transfer of numBytes consecutive registers. On
+  success the shadowed registers take the transferred values; on failure
+  their state on the device is unknown and they are invalidated.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::shadowStore(__u8 regAddr, __u8 * dataBytes, __u8 numBytes,
+                               __u8 lidarliteAddress, __u8 success)
+{
+    LLv3_Shadow * shadow;
+    __s8  index;
+    __u8  i;
+
+    if ((shadow = shadowFor(lidarliteAddress, success)) == NULL)
+        return;
+
+    for (i=0 ; i<numBytes ; i++)
+    {
+        if ((index = llv3_shadowIndex((regAddr & 0x7f) + i)) < 0)
+            continue;
+
+        if (success)
+        {
+            shadow->values[index] = dataBytes[i];
+            shadow->valid        |= (1 << index);
+        }
+        else
+        {
+            shadow->valid        &= ~(1 << index);
+        }
+    }
+} /* LIDARLite_v3::shadowStore */
+
+/*------------------------------------------------------------------------------
+  Invalidate Shadow
+  Forget the configuration registers remembered for a device, e.g. after it
+  was power cycled, so the next writes go to the device. The UNIT_ID serial
+  number is kept.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::invalidateShadow(__u8 lidarliteAddress)
+{
+    LLv3_Shadow * shadow = shadowFor(lidarliteAddress, 0);
+
+    if (shadow)
+        shadow->valid &= LLv3_SHADOW_IDENTITY;
+} /* LIDARLite_v3::invalidateShadow */
+
+/*------------------------------------------------------------------------------
+  Forget Shadow
+  Drop everything remembered for an address, UNIT_ID included. An address
+  is not a device identity: once a unit moves away, another unit may
+  answer in its place.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::forgetShadow(__u8 lidarliteAddress)
+{
+    LLv3_Shadow * shadow = shadowFor(lidarliteAddress, 0);
+
+    if (shadow)
+    {
+        shadow->used  = 0;
+        shadow->valid = 0;
+    }
+} /* LIDARLite_v3::forgetShadow */
+
+/*------------------------------------------------------------------------------
+  Shadow Counters
+  getShadowHits returns the number of transfers of shadowed registers that
+  were answered or suppressed without bus traffic. getShadowMisses returns
+  the number that had to go to the device.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3::getShadowHits(void)
+{
+    return shadowHits;
+}
+
+__u32 LIDARLite_v3::getShadowMisses(void)
+{
+    return shadowMisses;
+}
 
 /*------------------------------------------------------------------------------
   Set I2C Address
@@ -176,9 +522,29 @@ void LIDARLite_v3::configure(__u8 configuration, __u8 lidarliteAddress)
 void LIDARLite_v3::setI2Caddr(__u8 newAddress, __u8 disableDefault, __u8 lidarliteAddress)
 {
     __u8 dataBytes[2];
+    LLv3_DeviceSetup * setup = setupFor(newAddress, 1);
+
+    // The device forgets its secondary address when it loses power
+    if (setup)
+    {
+        setup->secondary      = 1;
+        setup->fromAddress    = lidarliteAddress;
+        setup->disableDefault = disableDefault;
+    }
 
-    // Read UNIT_ID serial number bytes and write them into I2C_ID byte locations
+    // The unit answering lidarliteAddress now may not be the one the
+    // shadow last saw there, so read its serial number from the bus
+    forgetShadow(lidarliteAddress);
+    forgetShadow(newAddress);
+
+    // Read UNIT_ID serial number bytes
     i2cRead ((LLv3_UNIT_ID_HIGH | 0x80), dataBytes, 2, lidarliteAddress);
+
+    // In LLv3_XFER_RDWR mode the writes to the current address go out in
+    // one ioctl
+    beginBatch();
+
+    // Write the UNIT_ID bytes into I2C_ID byte locations
     i2cWrite(LLv3_I2C_ID_HIGH,           dataBytes, 2, lidarliteAddress);
 
     // Write the new I2C device address to registers
@@ -189,12 +555,24 @@ void LIDARLite_v3::setI2Caddr(__u8 newAddress, __u8 disableDefault, __u8 lidarli
     dataBytes[0] = 0;
     i2cWrite(LLv3_I2C_CONFIG,            dataBytes, 1, lidarliteAddress);
 
+    endBatch();
+
+    // The device may still be applying I2C_CONFIG when the next message
+    // arrives and NAK newAddress, so traffic to newAddress never shares a
+    // submission with it, even inside a caller's batch
+    i2cFlush();
+
     // If desired, disable default I2C device address (using the new I2C device address)
     if (disableDefault)
     {
         dataBytes[0] = (1 << 3); // set bit to disable default address
         i2cWrite(LLv3_I2C_CONFIG, dataBytes, 1, newAddress);
     }
+
+    // The unit has moved; whatever answers lidarliteAddress next, and the
+    // moved unit's settings at newAddress, are unknown
+    forgetShadow(lidarliteAddress);
+    forgetShadow(newAddress);
 } /* LIDARLite_v3::setI2Caddr */
 
 /*------------------------------------------------------------------------------
@@ -208,134 +586,929 @@ void LIDARLite_v3::setI2Caddr(__u8 newAddress, __u8 disableDefault, __u8 lidarli
 ------------------------------------------------------------------------------*/
 void LIDARLite_v3::takeRange(__u8 lidarliteAddress)
 {
+    LLv3_DeviceSetup * setup;
     __u8 commandByte = 0x04;
 
     i2cWrite(LLv3_ACQ_CMD, &commandByte, 1, lidarliteAddress);
+
+    // The acquisition starts when the write completes
+    if ((setup = setupFor(lidarliteAddress, 1)) != NULL)
+        setup->triggerNs = llv3_monotonicNs();
 } /* LIDARLite_v3::takeRange */
 
 /*------------------------------------------------------------------------------
   Wait for Busy Flag
-  Blocking function to wait until the Lidar Lite's internal busy flag goes low
+  Blocking function to wait until the Lidar Lite's internal busy flag goes low.
+  How it waits is selected with setWaitPolicy.
 
   Parameters
   ------------------------------------------------------------------------------
   lidarliteAddress: Default 0x62. Fill in new address here if changed. See
     operating manual for instructions.
+
+  Returns 0 once the device is not busy, or -1 if the timeout set with
+  setWaitPolicy expired first or the busy flag could not be read.
 ------------------------------------------------------------------------------*/
-void LIDARLite_v3::waitForBusy(__u8 lidarliteAddress)
+__s32 LIDARLite_v3::waitForBusy(__u8 lidarliteAddress)
 {
-    __u8  busyFlag;
+    __u64 deadline = 0;
 
-    do  // Loop until device is not busy
-    {
-        busyFlag = getBusyFlag(lidarliteAddress);
-    } while (busyFlag);
+    if (waitTimeoutUs)
+        deadline = llv3_monotonicNs() + (__u64) waitTimeoutUs * 1000;
+
+    return (waitUntil(deadline, lidarliteAddress) == LLv3_OK) ? 0 : -1;
 } /* LIDARLite_v3::waitForBusy */
 
 /*------------------------------------------------------------------------------
-  Get Busy Flag
-  Read BUSY flag from device registers. Function will return 0x00 if not busy.
+  Wait Until
+  Wait for the busy flag as selected with setWaitPolicy, giving up at the
+  llv3_monotonicNs() time 'deadline' (0 waits forever).
 
-  Parameters
-  ------------------------------------------------------------------------------
-  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
-    operating manual for instructions.
+  Returns LLv3_OK, LLv3_ERR_TIMEOUT, or LLv3_ERR_BUS if STATUS could not be
+  read.
 ------------------------------------------------------------------------------*/
-__u8 LIDARLite_v3::getBusyFlag(__u8 lidarliteAddress)
+__s32 LIDARLite_v3::waitUntil(__u64 deadline, __u8 lidarliteAddress)
 {
-    __u8  statusByte = 0;
-    __u8  busyFlag; // busyFlag monitors when the device is done with a measurement
+    LLv3_DeviceSetup * setup;
+    __u64 now;
+    __u64 due;
+    __u32 sleepUs  = LLv3_WAIT_POLL_US;
+    __u8  statusByte;
 
-    // Read status register to check busy flag
-    i2cRead(LLv3_STATUS, &statusByte, 1, lidarliteAddress);
+    // Once the mode pin reports the measurement done, STATUS is still read
+    // once below: only it tells whether the measurement found a signal
+#ifdef LLv3_TRANSPORT_SIM
+    if (waitPolicy == LLv3_WAIT_GPIO && gpioFd >= 0 &&
+        LLv3_SimModel::get(busNumber)->waitModePin(gpioFd, deadline) == -1)
+        return LLv3_ERR_TIMEOUT;
+#else
+    if (waitPolicy == LLv3_WAIT_GPIO && gpioFd >= 0)
+    {
+        struct gpiohandle_data data;
+        struct gpioevent_data  event;
+        struct pollfd          pfd;
+        struct timespec        remaining;
+        struct timespec *      timeout = NULL;
 
-    // STATUS bit 0 is busyFlag
-    busyFlag = statusByte & 0x01;
+        pfd.fd     = gpioFd;
+        pfd.events = POLLIN;
 
-    return busyFlag;
-} /* LIDARLite_v3::getBusyFlag */
+        while (1)
+        {
+            // Check the level first; the measurement may already be done
+            if (ioctl(gpioFd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0)
+                break; // Fall back to reading the busy flag over I2C
 
-/*------------------------------------------------------------------------------
-  Read Distance
-  Read and return result of distance measurement.
+            if (data.values[0] != gpioBusyLevel)
+                break;
 
-  Parameters
-  ------------------------------------------------------------------------------
-  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
-    operating manual for instructions.
-------------------------------------------------------------------------------*/
-__u16 LIDARLite_v3::readDistance(__u8 lidarliteAddress)
-{
-    __u8  distBytes[2] = {0};
+            if (deadline)
+            {
+                now = llv3_monotonicNs();
 
-    // Read two bytes from register 0x0f and 0x10 (autoincrement)
-    i2cRead((LLv3_DISTANCE | 0x80), distBytes, 2, lidarliteAddress);
+                if (now >= deadline)
+                    return LLv3_ERR_TIMEOUT;
 
-    // Shift high byte and OR in low byte
-    return ((distBytes[0] << 8) | distBytes[1]);
-} /* LIDARLite_v3::readDistance */
+                remaining.tv_sec  = (deadline - now) / 1000000000ull;
+                remaining.tv_nsec = (deadline - now) % 1000000000ull;
+                timeout = &remaining;
+            }
+
+            if (ppoll(&pfd, 1, timeout, NULL) > 0)
+                read(gpioFd, &event, sizeof(event)); // Consume the edge
+        }
+    }
+#endif
+
+    // Sleep through most of the measurement before touching the bus. The
+    // prediction is a worst case, so only up to half of it after the
+    // trigger. Without a known trigger the device is polled right away.
+    if (waitPolicy == LLv3_WAIT_PREDICT &&
+        (setup = setupFor(lidarliteAddress, 0)) != NULL && setup->triggerNs)
+    {
+        due = setup->triggerNs + (__u64) getPredictedAcqUs(lidarliteAddress) * 500;
+        now = llv3_monotonicNs();
+
+        if (due > now)
+            llv3_sleepUs((due - now) / 1000);
+    }
+
+    while (1) // Loop until device is not busy
+    {
+        if (i2cRead(LLv3_STATUS, &statusByte, 1, lidarliteAddress) != 1)
+            return LLv3_ERR_BUS;
+
+        lastStatus = statusByte;
+
+        if (!(statusByte & 0x01))
+            break;
+
+        if (deadline && llv3_monotonicNs() >= deadline)
+            return LLv3_ERR_TIMEOUT;
+
+        if (waitPolicy == LLv3_WAIT_PREDICT)
+        {
+            llv3_sleepUs(LLv3_WAIT_POLL_US);
+        }
+        else if (waitPolicy == LLv3_WAIT_BACKOFF)
+        {
+            llv3_sleepUs(sleepUs);
+
+            sleepUs *= 2;
+            if (sleepUs > LLv3_WAIT_BACKOFF_MAX_US)
+                sleepUs = LLv3_WAIT_BACKOFF_MAX_US;
+        }
+    }
+
+    return LLv3_OK;
+} /* LIDARLite_v3::waitUntil */
 
 /*------------------------------------------------------------------------------
-  Write
-  Perform I2C write to device.
+  Measure
+  Take one measurement with bounded time and retries. Each attempt triggers
+  a measurement, waits for it until a deadline and reads the distance
+  together with the signal strength. A failed attempt is followed by a
+  sleep that doubles with every attempt and by recover(), since a bus error
+  or a measurement that never ends usually means the bus glitched or the
+  device lost power.
 
   Parameters
   ------------------------------------------------------------------------------
-  regAddr:   register address to write to
-  dataBytes: pointer to data bytes to write
-  numBytes:  number of bytes to write
+  sample: receives the measurement. On failure its distance is 0 and its
+    status has LLv3_STATUS_INVALID set.
   lidarliteAddress: Default 0x62. Fill in new address here if changed. See
     operating manual for instructions.
+
+  Returns LLv3_OK or the LLv3_ERR_* code of the last failed attempt.
 ------------------------------------------------------------------------------*/
-__s32 LIDARLite_v3::i2cWrite(__u8 regAddr,  __u8 * dataBytes,
-                             __u8 numBytes, __u8 lidarliteAddress)
+__s32 LIDARLite_v3::measure(LLv3_Sample * sample, __u8 lidarliteAddress)
 {
-    __u8 buffer[2];
-    __u8 i;
+    __u32 backoffUs = retryBackoffUs;
     __s32 result;
+    __u8  attempt;
 
-    i2c_connect(lidarliteAddress);
+    result = measureOnce(sample, lidarliteAddress);
 
-    for (i=0 ; i<numBytes ; i++)
+    for (attempt=0 ; attempt<retryMax && result != LLv3_OK ; attempt++)
     {
-        buffer[0] = regAddr + i;
-        buffer[1] = dataBytes[i];
-        result   |= write(file_i2c, buffer, 2);
+        stats.countRetry();
+        llv3_sleepUs(backoffUs);
+
+        backoffUs *= 2;
+        if (backoffUs > LLv3_RETRY_BACKOFF_MAX_US)
+            backoffUs = LLv3_RETRY_BACKOFF_MAX_US;
+
+        if ((result = recover(lidarliteAddress)) == LLv3_OK)
+            result = measureOnce(sample, lidarliteAddress);
+    }
+
+    if (result != LLv3_OK)
+    {
+        sample->timestamp = llv3_monotonicNs();
+        sample->trigger   = 0;
+        sample->distance  = 0;
+        sample->status    = LLv3_STATUS_INVALID;
+        sample->address   = lidarliteAddress;
+        sample->bus       = busNumber;
+        sample->signal    = 0;
     }
 
+    if (recorder)
+        recorder->logSample(sample);
+
     return result;
-} /* LIDARLite_v3::i2cWrite */
+} /* LIDARLite_v3::measure */
 
 /*------------------------------------------------------------------------------
-  Read
-  Perform I2C read from device.
-
-  Parameters
-  ------------------------------------------------------------------------------
-  regAddr:   register address to write to
-  dataBytes: pointer to array to place read bytes
-  numBytes:  number of bytes in 'dataBytes' array to read (32 bytes max)
-  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
-  operating manual for instructions.
+  Measure Once
+  One attempt of measure(), without retries or recovery
 ------------------------------------------------------------------------------*/
-__s32 LIDARLite_v3::i2cRead(__u8 regAddr,  __u8 * dataBytes,
-                            __u8 numBytes, __u8 lidarliteAddress)
+__s32 LIDARLite_v3::measureOnce(LLv3_Sample * sample, __u8 lidarliteAddress)
 {
-    __u8 buffer;
+    LLv3_DeviceSetup * setup;
+    __u8  commandByte = 0x04;
+    __u8  resultBytes[3];
+    __u32 timeoutUs   = deadlineUs;
+    __u64 deadline;
+    __s32 result;
 
-    i2c_connect(lidarliteAddress);
+    if (timeoutUs == 0)
+        timeoutUs = 2 * getPredictedAcqUs(lidarliteAddress) + LLv3_DEADLINE_SLACK_US;
 
-    buffer = regAddr;
+    deadline = llv3_monotonicNs() + (__u64) timeoutUs * 1000;
 
-    write(file_i2c, &buffer, 1);
-    return read(file_i2c, dataBytes, numBytes);
-} /* LIDARLite_v3::i2cRead */
+    if (i2cWrite(LLv3_ACQ_CMD, &commandByte, 1, lidarliteAddress) < 0)
+        return LLv3_ERR_BUS;
 
-/*------------------------------------------------------------------------------
-  Correlation Record Read
-  The correlation record used to calculate distance can be read from the device.
-  It has a bipolar wave shape, transitioning from a positive going portion to a
-  roughly symmetrical negative going pulse. The point where the signal crosses
+    sample->trigger = llv3_monotonicNs();
+
+    if ((setup = setupFor(lidarliteAddress, 1)) != NULL)
+        setup->triggerNs = sample->trigger;
+
+    if ((result = waitUntil(deadline, lidarliteAddress)) != LLv3_OK)
+        return result;
+
+    // SIGNAL_STRENGTH sits just before the distance, so one more byte in
+    // the same auto-increment read returns it too
+    if (i2cRead((LLv3_SIGNAL_STRENGTH | 0x80), resultBytes, 3, lidarliteAddress) != 3)
+        return LLv3_ERR_BUS;
+
+    sample->timestamp = llv3_monotonicNs();
+    sample->distance  = (resultBytes[1] << 8) | resultBytes[2];
+    sample->status    = lastStatus & ~LLv3_STATUS_INVALID;
+    sample->address   = lidarliteAddress;
+    sample->bus       = busNumber;
+    sample->signal    = resultBytes[0];
+
+    return LLv3_OK;
+} /* LIDARLite_v3::measureOnce */
+
+/*------------------------------------------------------------------------------
+  Set Retry Policy
+  Configure measure()
+
+  Parameters
+  ------------------------------------------------------------------------------
+  maxRetries: attempts after the first one. Default LLv3_RETRY_MAX_DEFAULT.
+  backoffUs:  sleep before the first retry, doubled for every further retry
+    up to LLv3_RETRY_BACKOFF_MAX_US. Default LLv3_RETRY_BACKOFF_US.
+  attemptDeadlineUs: time one attempt may take from trigger to result.
+    Default 0, twice the worst case time of the active preset plus
+    LLv3_DEADLINE_SLACK_US.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::setRetryPolicy(__u8 maxRetries, __u32 backoffUs, __u32 attemptDeadlineUs)
+{
+    retryMax       = maxRetries;
+    retryBackoffUs = backoffUs;
+    deadlineUs     = attemptDeadlineUs;
+} /* LIDARLite_v3::setRetryPolicy */
+
+/*------------------------------------------------------------------------------
+  Setup For
+  Find the remembered setup of a device, allocating a free entry if
+  'create' is set. Returns NULL if the device has no entry (and none is
+  free).
+------------------------------------------------------------------------------*/
+LLv3_DeviceSetup * LIDARLite_v3::setupFor(__u8 lidarliteAddress, __u8 create)
+{
+    __u8 i;
+
+    for (i=0 ; i<LLv3_SHADOW_MAX_DEVICES ; i++)
+    {
+        if (setups[i].used && setups[i].address == lidarliteAddress)
+            return &setups[i];
+    }
+
+    for (i=0 ; create && i<LLv3_SHADOW_MAX_DEVICES ; i++)
+    {
+        if (!setups[i].used)
+        {
+            memset(&setups[i], 0, sizeof(setups[i]));
+            setups[i].used    = 1;
+            setups[i].address = lidarliteAddress;
+            return &setups[i];
+        }
+    }
+
+    return NULL;
+} /* LIDARLite_v3::setupFor */
+
+/*------------------------------------------------------------------------------
+  Recover
+  Bring a device back after a bus glitch or power loss: reopen the i2c bus,
+  resubmit writes still queued in a batch, move the device back to the secondary address set with
+  setI2Caddr() if it no longer answers there, forget its register shadow
+  and apply the last configure() preset again. The time taken is accounted
+  as LLv3_OP_RECOVER in getStats().
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+
+  Returns LLv3_OK if the device answers afterwards, or LLv3_ERR_RECOVERY.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::recover(__u8 lidarliteAddress)
+{
+    LLv3_DeviceSetup * setup = setupFor(lidarliteAddress, 1);
+    __u64 start = llv3_monotonicNs();
+    __s32 result = LLv3_OK;
+    __u8  queued = batchCount;
+    __u8  statusByte;
+
+    invalidateShadow(lidarliteAddress);
+
+    if (replay == NULL)
+    {
+        bus.close();
+        boundAddress = -1;
+
+        if (bus.open(busNumber) < 0)
+            result = LLv3_ERR_RECOVERY;
+    }
+
+    // Writes queued for any device go out on the reopened bus. If that
+    // fails, i2cFlush forgets them in the shadow so they are written again.
+    if (i2cFlush() < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to submit %d queued writes during recovery: %s\n", queued, strerror(errno));
+    }
+
+    if (result == LLv3_OK && setup && setup->secondary &&
+        i2cRead(LLv3_STATUS, &statusByte, 1, lidarliteAddress) != 1)
+    {
+        // After a power loss the device answers at its default address
+        // again, possibly alongside other units that lost power; its serial
+        // number must come from the bus, not from the shadow
+        forgetShadow(setup->fromAddress);
+        setI2Caddr(lidarliteAddress, setup->disableDefault, setup->fromAddress);
+    }
+
+    if (result == LLv3_OK && setup && setup->hasPreset)
+        configure(setup->preset, lidarliteAddress);
+
+    if (result == LLv3_OK &&
+        i2cRead(LLv3_STATUS, &statusByte, 1, lidarliteAddress) != 1)
+        result = LLv3_ERR_RECOVERY;
+
+    statsOp(LLv3_OP_RECOVER, start, (result != LLv3_OK), 0, lidarliteAddress);
+
+    return result;
+} /* LIDARLite_v3::recover */
+
+/*------------------------------------------------------------------------------
+  Set Wait Policy
+  Select how waitForBusy waits for a measurement to complete.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  policy:
+    LLv3_WAIT_SPIN:    Default. Read the busy flag back to back.
+    LLv3_WAIT_PREDICT: Sleep until half of the worst case measurement time
+        of the device's preset (see getPredictedAcqUs) has passed since
+        takeRange, then poll the busy flag every LLv3_WAIT_POLL_US.
+    LLv3_WAIT_BACKOFF: Poll the busy flag, doubling the sleep between reads
+        from LLv3_WAIT_POLL_US up to LLv3_WAIT_BACKOFF_MAX_US.
+    LLv3_WAIT_GPIO:    Block on the mode pin line set up with gpioInit,
+        without any I2C traffic. Requires configure(6), which puts the mode
+        pin in status output mode. Falls back to spinning if no line is set up.
+  timeoutUs: Default 0 (wait forever). Otherwise waitForBusy gives up and
+    returns -1 after this many microseconds.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::setWaitPolicy(__u8 policy, __u32 timeoutUs)
+{
+    waitPolicy    = policy;
+    waitTimeoutUs = timeoutUs;
+} /* LIDARLite_v3::setWaitPolicy */
+
+/*------------------------------------------------------------------------------
+  Get Predicted Acquisition Time
+  Worst case measurement time of the preset last applied to a device with
+  configure(), in microseconds. Devices never configured are assumed to run
+  the default preset.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3::getPredictedAcqUs(__u8 lidarliteAddress)
+{
+    LLv3_DeviceSetup * setup = setupFor(lidarliteAddress, 0);
+
+    if (setup && setup->hasPreset)
+        return setup->preset.acqTimeUs();
+
+    return llv3_presetAcqTimeUs(0);
+} /* LIDARLite_v3::getPredictedAcqUs */
+
+/*------------------------------------------------------------------------------
+  GPIO Init
+  Request the GPIO line wired to the LIDAR-Lite mode pin through the GPIO
+  character device, for use by LLv3_WAIT_GPIO.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  chipPath:   GPIO character device, e.g. "/dev/gpiochip0" on the Raspberry Pi
+  lineOffset: line number on that chip, e.g. 17 for GPIO 17
+  busyLevel:  Default 1. Line level while a measurement is in progress.
+
+  Built with -DLLv3_TRANSPORT_SIM, 'chipPath' is ignored and 'lineOffset' is
+  the I2C address of the simulated device whose mode pin is used.
+
+  Returns 0 on success or -1 on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::gpioInit(const char * chipPath, __u32 lineOffset, __u8 busyLevel)
+{
+#ifdef LLv3_TRANSPORT_SIM
+    (void) chipPath;
+
+    gpioFd        = lineOffset;
+    gpioBusyLevel = busyLevel;
+
+    return 0;
+#else
+    struct gpioevent_request request;
+    __s32 chipFd;
+    __s32 result;
+
+    if ((chipFd = open(chipPath, O_RDONLY)) < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to open the gpio chip");
+        return -1;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.lineoffset  = lineOffset;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    request.eventflags  = GPIOEVENT_REQUEST_BOTH_EDGES;
+    strncpy(request.consumer_label, "lidarlite_v3", sizeof(request.consumer_label) - 1);
+
+    result = ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    close(chipFd);
+
+    if (result < 0)
+    {
+        printf("Failed to request the mode pin gpio line.\n");
+        //ERROR HANDLING; you can check errno to see what went wrong
+        return -1;
+    }
+
+    if (gpioFd >= 0)
+        close(gpioFd);
+
+    gpioFd        = request.fd;
+    gpioBusyLevel = busyLevel;
+
+    return 0;
+#endif
+} /* LIDARLite_v3::gpioInit */
+
+/*------------------------------------------------------------------------------
+  Get Busy Flag
+  Read BUSY flag from device registers. Function will return 0x00 if not busy.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+__u8 LIDARLite_v3::getBusyFlag(__u8 lidarliteAddress)
+{
+    __u8  busyFlag; // busyFlag monitors when the device is done with a measurement
+
+    // STATUS bit 0 is busyFlag
+    busyFlag = getStatus(lidarliteAddress) & 0x01;
+
+    return busyFlag;
+} /* LIDARLite_v3::getBusyFlag */
+
+/*------------------------------------------------------------------------------
+  Get Status
+  Read and return the STATUS register. Bit 0 is the busy flag; the remaining
+  bits report health, overflow and signal validity. See operating manual.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+__u8 LIDARLite_v3::getStatus(__u8 lidarliteAddress)
+{
+    __u8  statusByte = 0;
+
+    i2cRead(LLv3_STATUS, &statusByte, 1, lidarliteAddress);
+
+    lastStatus = statusByte;
+
+    return statusByte;
+} /* LIDARLite_v3::getStatus */
+
+/*------------------------------------------------------------------------------
+  Read Distance
+  Read and return result of distance measurement.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+__u16 LIDARLite_v3::readDistance(__u8 lidarliteAddress)
+{
+    __u8  distBytes[2] = {0};
+    __u16 distance;
+
+    // Read two bytes from register 0x0f and 0x10 (autoincrement)
+    i2cRead((LLv3_DISTANCE | 0x80), distBytes, 2, lidarliteAddress);
+
+    // Shift high byte and OR in low byte
+    distance = ((distBytes[0] << 8) | distBytes[1]);
+
+    if (recorder)
+    {
+        LLv3_Sample sample;
+        LLv3_DeviceSetup * setup = setupFor(lidarliteAddress, 0);
+
+        sample.timestamp = llv3_monotonicNs();
+        sample.trigger   = setup ? setup->triggerNs : 0;
+        sample.distance  = distance;
+        sample.status    = lastStatus;
+        sample.address   = lidarliteAddress;
+        sample.bus       = busNumber;
+        sample.signal    = 0;
+
+        recorder->logSample(&sample);
+    }
+
+    return distance;
+} /* LIDARLite_v3::readDistance */
+
+/*------------------------------------------------------------------------------
+  Set Transfer Mode
+  Select how i2cWrite and i2cRead talk to the i2c-dev driver.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  mode: LLv3_XFER_READWRITE (default) binds the slave address with
+    ioctl(I2C_SLAVE) and then issues one write() per register byte, or a
+    write() of the register pointer followed by a read().
+    LLv3_XFER_RDWR sends each operation as a single ioctl(I2C_RDWR) with
+    combined i2c_msg segments. Writes between beginBatch() and endBatch() are
+    queued and submitted together.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::setTransferMode(__u8 mode)
+{
+    i2cFlush();
+    xferMode = mode;
+} /* LIDARLite_v3::setTransferMode */
+
+/*------------------------------------------------------------------------------
+  Begin Batch
+  Start queuing register writes. Calls may be nested; the queue is submitted
+  when the outermost endBatch() is reached, when it fills up, or before any
+  read so that ordering on the bus is preserved. Has no effect in
+  LLv3_XFER_READWRITE mode.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::beginBatch(void)
+{
+    batchDepth++;
+} /* LIDARLite_v3::beginBatch */
+
+/*------------------------------------------------------------------------------
+  End Batch
+  Close a batch opened by beginBatch() and submit the queued writes if this
+  was the outermost batch. Returns 0 on success or -1 if the submission failed.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::endBatch(void)
+{
+    if (batchDepth)
+        batchDepth--;
+
+    if (batchDepth)
+        return 0;
+
+    return i2cFlush();
+} /* LIDARLite_v3::endBatch */
+
+/*------------------------------------------------------------------------------
+  Flush
+  Submit all queued write messages in one ioctl(I2C_RDWR).
+  Returns 0 on success (or if nothing was queued) and -1 on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::i2cFlush(void)
+{
+    __u64 start;
+    __s32 result;
+    __u8  i;
+
+    if (batchCount == 0)
+        return 0;
+
+    start  = llv3_monotonicNs();
+    result = bus.transfer(batchMsgs, batchCount);
+    statsOp(LLv3_OP_BATCH, start, (result < 0), batchData[0][0], batchMsgs[0].addr);
+
+    // The queued registers were shadowed when queued; undo that on failure
+    if (result < 0)
+    {
+        for (i=0 ; i<batchCount ; i++)
+            shadowStore(batchData[i][0], &batchData[i][1], 1, batchMsgs[i].addr, 0);
+    }
+
+    batchCount = 0;
+
+    return (result < 0) ? -1 : 0;
+} /* LIDARLite_v3::i2cFlush */
+
+/*------------------------------------------------------------------------------
+  Write
+  Perform I2C write to device. Each data byte is written to its own register,
+  starting at regAddr.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  regAddr:   register address to write to
+  dataBytes: pointer to data bytes to write
+  numBytes:  number of bytes to write
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+
+  Writes of configuration registers that the register shadow knows to hold
+  the same values already are skipped.
+
+  Returns numBytes on success or -1 on failure. Writes queued inside a batch
+  report success; a failed submission is reported by endBatch().
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::i2cWrite(__u8 regAddr,  __u8 * dataBytes,
+                             __u8 numBytes, __u8 lidarliteAddress)
+{
+    __s32 result;
+
+    stats.countWrite(regAddr, numBytes);
+
+    // Writing 0x00 to ACQ_CMD resets the device's registers to defaults
+    if ((regAddr & 0x7f) == LLv3_ACQ_CMD && numBytes && dataBytes[0] == 0x00)
+        invalidateShadow(lidarliteAddress);
+
+    // Skip writes of values the device is known to hold already
+    if (shadowLookup(regAddr, dataBytes, numBytes, lidarliteAddress, 1) > 0)
+        return numBytes;
+
+    if (replay)
+        result = replay->write(regAddr, dataBytes, numBytes, lidarliteAddress);
+    else
+        result = i2cWriteBus(regAddr, dataBytes, numBytes, lidarliteAddress);
+
+    shadowStore(regAddr, dataBytes, numBytes, lidarliteAddress, (result >= 0));
+
+    if (recorder)
+        recorder->logTransfer(LLv3_REC_WRITE, lidarliteAddress, regAddr,
+                              dataBytes, numBytes, (result < 0));
+
+    return result;
+} /* LIDARLite_v3::i2cWrite */
+
+/*------------------------------------------------------------------------------
+  Write Bus
+  Transfer for i2cWrite in the selected transfer mode
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::i2cWriteBus(__u8 regAddr,  __u8 * dataBytes,
+                                __u8 numBytes, __u8 lidarliteAddress)
+{
+    __u8 buffer[2];
+    __u8 i;
+    __s32 result = numBytes;
+
+    if (xferMode == LLv3_XFER_RDWR)
+    {
+        for (i=0 ; i<numBytes ; i++)
+        {
+            if (batchCount == LLv3_BATCH_MAX_MSGS)
+            {
+                if (i2cFlush() < 0)
+                    result = -1;
+            }
+
+            batchData[batchCount][0]     = regAddr + i;
+            batchData[batchCount][1]     = dataBytes[i];
+            batchMsgs[batchCount].addr   = lidarliteAddress;
+            batchMsgs[batchCount].flags  = 0;
+            batchMsgs[batchCount].len    = 2;
+            batchMsgs[batchCount].buf    = batchData[batchCount];
+            batchCount++;
+        }
+
+        // Outside of a batch every write is submitted immediately
+        if (batchDepth == 0)
+        {
+            if (i2cFlush() < 0)
+                result = -1;
+        }
+
+        return result;
+    }
+
+    if (i2c_connect(lidarliteAddress) < 0)
+        return -1;
+
+    for (i=0 ; i<numBytes ; i++)
+    {
+        __u64 start = llv3_monotonicNs();
+        __u8  failed;
+
+        buffer[0] = regAddr + i;
+        buffer[1] = dataBytes[i];
+
+        failed = (bus.write(buffer, 2) != 2);
+        statsOp(LLv3_OP_WRITE, start, failed, regAddr + i, lidarliteAddress);
+
+        if (failed)
+            result = -1;
+    }
+
+    return result;
+} /* LIDARLite_v3::i2cWriteBus */
+
+/*------------------------------------------------------------------------------
+  Read
+  Perform I2C read from device.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  regAddr:   register address to write to
+  dataBytes: pointer to array to place read bytes
+  numBytes:  number of bytes in 'dataBytes' array to read (32 bytes max)
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+  operating manual for instructions.
+
+  Returns the number of bytes read or -1 on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::i2cRead(__u8 regAddr,  __u8 * dataBytes,
+                            __u8 numBytes, __u8 lidarliteAddress)
+{
+    __s32 result;
+    __u8  consecutive = (numBytes == 1) || (regAddr & 0x80);
+
+    stats.countRead(regAddr, numBytes);
+
+    // Known configuration and identity registers are answered locally
+    if (consecutive &&
+        shadowLookup(regAddr, dataBytes, numBytes, lidarliteAddress, 0) > 0)
+        return numBytes;
+
+    if (replay)
+        result = replay->read(regAddr, dataBytes, numBytes, lidarliteAddress);
+    else
+        result = i2cReadBus(regAddr, dataBytes, numBytes, lidarliteAddress);
+
+    if (consecutive && result == numBytes)
+        shadowStore(regAddr, dataBytes, numBytes, lidarliteAddress, 1);
+
+    if (recorder)
+        recorder->logTransfer(LLv3_REC_READ, lidarliteAddress, regAddr,
+                              dataBytes, (result < 0) ? 0 : result, (result < 0));
+
+    return result;
+} /* LIDARLite_v3::i2cRead */
+
+/*------------------------------------------------------------------------------
+  Read Bus
+  Transfer for i2cRead in the selected transfer mode
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::i2cReadBus(__u8 regAddr,  __u8 * dataBytes,
+                               __u8 numBytes, __u8 lidarliteAddress)
+{
+    __u8  buffer;
+    __u64 start;
+    __s32 result;
+
+    if (xferMode == LLv3_XFER_RDWR)
+    {
+        struct i2c_msg msgs[2];
+
+        // Queued writes must reach the device before this read
+        if (i2cFlush() < 0)
+            return -1;
+
+        start = llv3_monotonicNs();
+
+        buffer = regAddr;
+
+        // Register pointer write and data read joined by a repeated START
+        msgs[0].addr  = lidarliteAddress;
+        msgs[0].flags = 0;
+        msgs[0].len   = 1;
+        msgs[0].buf   = &buffer;
+        msgs[1].addr  = lidarliteAddress;
+        msgs[1].flags = I2C_M_RD;
+        msgs[1].len   = numBytes;
+        msgs[1].buf   = dataBytes;
+
+        result = bus.transfer(msgs, 2);
+        statsOp(LLv3_OP_READ, start, (result < 0), regAddr, lidarliteAddress);
+
+        return (result < 0) ? -1 : numBytes;
+    }
+
+    if (i2c_connect(lidarliteAddress) < 0)
+        return -1;
+
+    start  = llv3_monotonicNs();
+    buffer = regAddr;
+
+    // A failed register pointer write would make the read return data from
+    // whatever register the device last pointed at
+    if (bus.write(&buffer, 1) != 1)
+        result = -1;
+    else
+        result = bus.read(dataBytes, numBytes);
+
+    statsOp(LLv3_OP_READ, start, (result != numBytes), regAddr, lidarliteAddress);
+
+    return (result < 0) ? -1 : result;
+} /* LIDARLite_v3::i2cReadBus */
+
+/*------------------------------------------------------------------------------
+  Set Recorder
+  Log every register transaction and decoded sample to 'sessionRecorder'.
+  Pass NULL to stop recording.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::setRecorder(LIDARLite_v3_Recorder * sessionRecorder)
+{
+    recorder = sessionRecorder;
+} /* LIDARLite_v3::setRecorder */
+
+/*------------------------------------------------------------------------------
+  Set Replay
+  Serve all register transactions from a recording instead of the bus. Pass
+  NULL to return to the bus.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3::setReplay(LIDARLite_v3_Replay * sessionReplay)
+{
+    replay = sessionReplay;
+} /* LIDARLite_v3::setReplay */
+
+/*------------------------------------------------------------------------------
+  Sign Extend Correlation
+  Turn raw {magnitude, sign} byte pairs read from CORR_DATA into signed
+  values. A non-zero sign byte marks a negative sample, whose high byte is
+  set to 0xff. Runs as a separate pass after the transfer so that it can be
+  vectorized (AVX2 / SSE2 on x86, NEON on the Raspberry Pi).
+
+  Parameters
+  ------------------------------------------------------------------------------
+  values: samples to convert in place
+  count:  number of samples
+------------------------------------------------------------------------------*/
+void llv3_signExtendCorrelation(__s16 * values, __u16 count)
+{
+    __u16  i = 0;
+    __u8 * bytes;
+
+    // The vector paths treat each pair as a little endian 16-bit word:
+    // sign byte in the high half, magnitude in the low half
+#if defined(__AVX2__)
+    const __m256i zero256  = _mm256_setzero_si256();
+    const __m256i lowMask  = _mm256_set1_epi16(0x00ff);
+    const __m256i highMask = _mm256_set1_epi16((short) 0xff00);
+
+    for ( ; i + 16 <= count ; i += 16)
+    {
+        __m256i raw  = _mm256_loadu_si256((__m256i *) &values[i]);
+        __m256i pos  = _mm256_cmpeq_epi16(_mm256_srli_epi16(raw, 8), zero256);
+        __m256i sign = _mm256_andnot_si256(pos, highMask);
+
+        _mm256_storeu_si256((__m256i *) &values[i],
+                            _mm256_or_si256(_mm256_and_si256(raw, lowMask), sign));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i zero128 = _mm_setzero_si128();
+    const __m128i low128  = _mm_set1_epi16(0x00ff);
+    const __m128i high128 = _mm_set1_epi16((short) 0xff00);
+
+    for ( ; i + 8 <= count ; i += 8)
+    {
+        __m128i raw  = _mm_loadu_si128((__m128i *) &values[i]);
+        __m128i pos  = _mm_cmpeq_epi16(_mm_srli_epi16(raw, 8), zero128);
+        __m128i sign = _mm_andnot_si128(pos, high128);
+
+        _mm_storeu_si128((__m128i *) &values[i],
+                         _mm_or_si128(_mm_and_si128(raw, low128), sign));
+    }
+#elif defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+    const uint16x8_t lowMask  = vdupq_n_u16(0x00ff);
+    const uint16x8_t highMask = vdupq_n_u16(0xff00);
+
+    for ( ; i + 8 <= count ; i += 8)
+    {
+        uint16x8_t raw  = vld1q_u16((uint16_t *) &values[i]);
+        uint16x8_t pos  = vceqq_u16(vshrq_n_u16(raw, 8), vdupq_n_u16(0));
+        uint16x8_t sign = vbicq_u16(highMask, pos);
+
+        vst1q_u16((uint16_t *) &values[i], vorrq_u16(vandq_u16(raw, lowMask), sign));
+    }
+#endif
+
+    // Remaining samples, or all of them on other platforms
+    for ( ; i < count ; i++)
+    {
+        bytes = (__u8 *) &values[i];
+
+        if (bytes[1])
+            values[i] = (__s16) (0xff00 | bytes[0]); // Artificially sign extend
+        else
+            values[i] = bytes[0];
+    }
+} /* llv3_signExtendCorrelation */
+
+/*------------------------------------------------------------------------------
+  Correlation Record Read
+  The correlation record used to calculate distance can be read from the device.
+  It has a bipolar wave shape, transitioning from a positive going portion to a
+  roughly symmetrical negative going pulse. The point where the signal crosses
   zero represents the effective delay for the reference and return signals.
 
   Process
@@ -356,15 +1529,16 @@ __s32 LIDARLite_v3::i2cRead(__u8 regAddr,  __u8 * dataBytes,
   numberOfReadings: Default = 256. Maximum = 1024
   lidarliteAddress: Default 0x62. Fill in new address here if changed. See
     operating manual for instructions.
+
+  Returns 0 on success, or -1 if reading the record failed. The contents of
+  'correlationArray' are then undefined and the record is not logged.
 ------------------------------------------------------------------------------*/
-void LIDARLite_v3::correlationRecordRead(__s16 * correlationArray,
-                                         __u16 numberOfReadings,
-                                         __u8  lidarliteAddress)
+__s32 LIDARLite_v3::correlationRecordRead(__s16 * correlationArray,
+                                          __u16 numberOfReadings,
+                                          __u8  lidarliteAddress)
 {
-    __u16  i = 0;
-    __u8   dataBytes[2];
-    __s16  correlationValue;
-    __u8 * correlationValuePtr = (__u8 *) &correlationValue;
+    __u8   dataBytes[1];
+    __s32  result;
 
     //  Select memory bank
     dataBytes[0] = 0xc0;
@@ -374,23 +1548,148 @@ void LIDARLite_v3::correlationRecordRead(__s16 * correlationArray,
     dataBytes[0] = 0x07;
     i2cWrite(LLv3_COMMAND, dataBytes, 1, lidarliteAddress);
 
-    for (i=0 ; i<numberOfReadings ; i++)
+    // Fetch straight into the caller's array, then sign extend in one pass
+    result = correlationBurst(correlationArray, numberOfReadings, lidarliteAddress);
+
+    if (result == 0)
     {
-        i2cRead((LLv3_CORR_DATA | 0x80), dataBytes, 2, lidarliteAddress);
+        llv3_signExtendCorrelation(correlationArray, numberOfReadings);
 
-        // First byte read is the magnitude of the data point
-        correlationValuePtr[0] = dataBytes[0];
+        if (recorder)
+            recorder->logCorrelation(lidarliteAddress, correlationArray, numberOfReadings);
+    }
 
-        // Second byte is the sign byte
-        if (dataBytes[1])
-            correlationValuePtr[1] = 0xff; // Artificially sign extend
-        else
-            correlationValuePtr[1] = 0x00;
+    // Test mode disable
+    dataBytes[0] = 0;
+    i2cWrite(LLv3_COMMAND, dataBytes, 1, lidarliteAddress);
+
+    return result;
+} /* LIDARLite_v3::correlationRecordRead */
 
-        correlationArray[i] = correlationValue;
+/*------------------------------------------------------------------------------
+  Correlation Record Stream
+  Same as correlationRecordRead, but the record is handed out in chunks of
+  LLv3_CORR_BURST_SAMPLES as each burst arrives, so the whole record never
+  needs to be held in memory.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  chunkBuffer: caller-provided scratch space for LLv3_CORR_BURST_SAMPLES values.
+    It is overwritten by every chunk.
+  handler: called once per chunk with the sign extended values, the index of
+    the first value in the record and the number of values
+  context: passed through to handler
+  numberOfReadings: Default = 256. Maximum = 1024
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+
+  Returns 0 on success, or -1 if a burst failed. The stream stops there;
+  the failed chunk and the ones after it are not handed out.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::correlationRecordStream(__s16 * chunkBuffer,
+                                            LLv3_CorrHandler handler,
+                                            void * context,
+                                            __u16 numberOfReadings,
+                                            __u8  lidarliteAddress)
+{
+    __u16  offset;
+    __u16  count;
+    __u8   dataBytes[1];
+    __s32  result = 0;
+
+    //  Select memory bank
+    dataBytes[0] = 0xc0;
+    i2cWrite(LLv3_ACQ_SETTINGS, dataBytes, 1, lidarliteAddress);
+
+    // Test mode enable
+    dataBytes[0] = 0x07;
+    i2cWrite(LLv3_COMMAND, dataBytes, 1, lidarliteAddress);
+
+    for (offset=0 ; offset<numberOfReadings ; offset+=count)
+    {
+        count = numberOfReadings - offset;
+        if (count > LLv3_CORR_BURST_SAMPLES)
+            count = LLv3_CORR_BURST_SAMPLES;
+
+        if ((result = correlationBurst(chunkBuffer, count, lidarliteAddress)) < 0)
+            break;
+
+        llv3_signExtendCorrelation(chunkBuffer, count);
+
+        handler(chunkBuffer, offset, count, context);
     }
 
     // Test mode disable
     dataBytes[0] = 0;
     i2cWrite(LLv3_COMMAND, dataBytes, 1, lidarliteAddress);
-} /* LIDARLite_v3::correlationRecordRead */
+
+    return result;
+} /* LIDARLite_v3::correlationRecordStream */
+
+/*------------------------------------------------------------------------------
+  Correlation Burst
+  Read raw {magnitude, sign} byte pairs from CORR_DATA directly into
+  'corrValues'. Test mode must already be enabled. In LLv3_XFER_RDWR mode up
+  to LLv3_CORR_BURST_SAMPLES reads are combined into each ioctl(I2C_RDWR).
+  Each sample is still its own register pointer write and 2-byte read, the
+  access pattern the device documents for the correlation memory.
+
+  Returns 0 on success, or -1 at the first failed transfer.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3::correlationBurst(__s16 * corrValues, __u16 count,
+                                     __u8 lidarliteAddress)
+{
+    struct i2c_msg msgs[2 * LLv3_CORR_BURST_SAMPLES];
+    __u8   regAddr = (LLv3_CORR_DATA | 0x80);
+    __u64  start;
+    __s32  result;
+    __u16  i;
+    __u16  n;
+
+    // Recording and replay see every sample as an individual i2cRead
+    if (xferMode != LLv3_XFER_RDWR || recorder || replay)
+    {
+        for (i=0 ; i<count ; i++)
+        {
+            if (i2cRead(regAddr, (__u8 *) &corrValues[i], 2, lidarliteAddress) != 2)
+                return -1;
+        }
+
+        return 0;
+    }
+
+    // Queued writes must reach the device before these reads
+    if (i2cFlush() < 0)
+        return -1;
+
+    while (count)
+    {
+        n = (count > LLv3_CORR_BURST_SAMPLES) ? LLv3_CORR_BURST_SAMPLES : count;
+
+        for (i=0 ; i<n ; i++)
+        {
+            msgs[2*i].addr    = lidarliteAddress;
+            msgs[2*i].flags   = 0;
+            msgs[2*i].len     = 1;
+            msgs[2*i].buf     = &regAddr;
+            msgs[2*i+1].addr  = lidarliteAddress;
+            msgs[2*i+1].flags = I2C_M_RD;
+            msgs[2*i+1].len   = 2;
+            msgs[2*i+1].buf   = (__u8 *) &corrValues[i];
+        }
+
+        stats.countRead(regAddr, 2 * n);
+
+        start  = llv3_monotonicNs();
+        result = bus.transfer(msgs, 2 * n);
+        statsOp(LLv3_OP_READ, start, (result < 0), regAddr, lidarliteAddress);
+
+        if (result < 0)
+            return -1;
+
+        corrValues += n;
+        count      -= n;
+    }
+
+    return 0;
+} /* LIDARLite_v3::correlationBurst */
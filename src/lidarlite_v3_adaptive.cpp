@@ -0,0 +1,195 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Adaptive acquisition settings
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <string.h>
+
+#include <include/lidarlite_v3_adaptive.h>
+
+/*------------------------------------------------------------------------------
+  Constructor
+  Starts with the default ladder on its slowest rung, so that the first
+  measurements reach as far as possible. Nothing is written to the device
+  until the first measure().
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance used for all bus transfers
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Adaptive::LIDARLite_v3_Adaptive(LIDARLite_v3 * lidarlite,
+                                             __u8 lidarliteAddress)
+{
+    lidar      = lidarlite;
+    address    = lidarliteAddress;
+    weakSignal = LLv3_ADAPT_WEAK_SIGNAL;
+    upCount    = LLv3_ADAPT_UP_COUNT;
+    marginPct  = LLv3_ADAPT_MARGIN_PCT;
+    switches   = 0;
+
+    setLadder(LLv3_ADAPT_LADDER, LLv3_ADAPT_NUM_RUNGS);
+}
+
+/*------------------------------------------------------------------------------
+  Set Ladder
+  Replace the presets to choose from and forget all learned range limits.
+  The controller restarts on the slowest rung.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  rungs: presets ordered from fastest to longest range
+  count: number of presets, 1 to LLv3_ADAPT_MAX_RUNGS
+
+  Returns 0 on success or -1 if 'count' is out of range.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Adaptive::setLadder(const LLv3_Preset * rungs, __u8 count)
+{
+    if (count == 0 || count > LLv3_ADAPT_MAX_RUNGS)
+        return -1;
+
+    memcpy(ladder, rungs, count * sizeof(LLv3_Preset));
+    memset(limitCm, 0, sizeof(limitCm));
+    memset(limitAge, 0, sizeof(limitAge));
+
+    numRungs    = count;
+    rung        = count - 1;
+    applied     = 0;
+    streak      = 0;
+    lastValidCm = 0;
+
+    return 0;
+} /* LIDARLite_v3_Adaptive::setLadder */
+
+/*------------------------------------------------------------------------------
+  Set Thresholds
+  Tune the switching rules. Raise 'weak' for dark or grazing targets whose
+  signal fades quickly, raise 'samplesUp' or lower 'margin' for fewer
+  switches.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  weak: SIGNAL_STRENGTH below which the current rung is left for a slower one
+  samplesUp: consecutive samples inside a faster rung's range before
+    switching to it
+  margin: percentage of a faster rung's range limit that counts as inside
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Adaptive::setThresholds(__u8 weak, __u8 samplesUp, __u8 margin)
+{
+    weakSignal = weak;
+    upCount    = (samplesUp > 0) ? samplesUp : 1;
+    marginPct  = margin;
+} /* LIDARLite_v3_Adaptive::setThresholds */
+
+/*------------------------------------------------------------------------------
+  Measure
+  Take one measurement with LIDARLite_v3::measure on the current rung, then
+  choose the rung for the next one. A sample without a valid return has
+  LLv3_STATUS_NO_SIGNAL set in its status; the next measurement already
+  uses a slower rung.
+
+  Returns the result of LIDARLite_v3::measure. Failed transfers say nothing
+  about the range and leave the rung unchanged.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Adaptive::measure(LLv3_Sample * sample)
+{
+    __s32 result;
+    __u8  invalid;
+    __u8  i;
+
+    if (!applied)
+    {
+        lidar->configure(ladder[rung], address);
+        applied = 1;
+    }
+
+    result = lidar->measure(sample, address);
+
+    for (i=0 ; i<numRungs ; i++)
+    {
+        if (limitCm[i] && ++limitAge[i] >= LLv3_ADAPT_FORGET_SAMPLES)
+            limitCm[i] = 0;
+    }
+
+    if (result != LLv3_OK)
+        return result;
+
+    invalid = (sample->status & LLv3_STATUS_UNUSABLE) ? 1 : 0;
+
+    if (invalid || sample->signal < weakSignal)
+    {
+        if (!invalid)
+            lastValidCm = sample->distance;
+
+        if (rung < numRungs - 1)
+        {
+            // With no valid distance yet, 1 cm keeps the rung closed until
+            // the limit is forgotten
+            limitCm[rung]  = (lastValidCm > 0) ? lastValidCm : 1;
+            limitAge[rung] = 0;
+            select(rung + 1);
+        }
+
+        return result;
+    }
+
+    lastValidCm = sample->distance;
+
+    if (rung > 0 && (limitCm[rung - 1] == 0 ||
+                     (__u32) sample->distance * 100 < (__u32) limitCm[rung - 1] * marginPct))
+    {
+        if (++streak >= upCount)
+            select(rung - 1);
+    }
+    else
+    {
+        streak = 0;
+    }
+
+    return result;
+} /* LIDARLite_v3_Adaptive::measure */
+
+/*------------------------------------------------------------------------------
+  Get Rung
+  Index in the ladder of the preset used by the next measure(), 0 being the
+  fastest
+------------------------------------------------------------------------------*/
+__u8 LIDARLite_v3_Adaptive::getRung(void)
+{
+    return rung;
+} /* LIDARLite_v3_Adaptive::getRung */
+
+/*------------------------------------------------------------------------------
+  Get Switch Count
+  Number of times the controller changed rungs
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Adaptive::getSwitchCount(void)
+{
+    return switches;
+} /* LIDARLite_v3_Adaptive::getSwitchCount */
+
+/*------------------------------------------------------------------------------
+  Select
+  Move to another rung and write its settings to the device
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Adaptive::select(__u8 newRung)
+{
+    rung   = newRung;
+    streak = 0;
+    switches++;
+
+    lidar->configure(ladder[rung], address);
+} /* LIDARLite_v3_Adaptive::select */
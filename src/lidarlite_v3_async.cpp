@@ -0,0 +1,267 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Non-blocking measurements for event loops
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <include/lidarlite_v3_async.h>
+
+/*------------------------------------------------------------------------------
+  Constructor
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance used for all bus transfers
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Async::LIDARLite_v3_Async(LIDARLite_v3 * lidarlite)
+{
+    lidar = lidarlite;
+    memset(ops, 0, sizeof(ops));
+
+    // Only relative timeouts are armed, so the clock choice does not matter
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (timerFd < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to create the measurement timer: %s\n", strerror(errno));
+    }
+}
+
+LIDARLite_v3_Async::~LIDARLite_v3_Async(void)
+{
+    if (timerFd >= 0)
+        close(timerFd);
+}
+
+/*------------------------------------------------------------------------------
+  Get Fd
+  File descriptor that becomes readable when dispatch() has work to do, or
+  -1 if it could not be created
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Async::getFd(void)
+{
+    return timerFd;
+} /* LIDARLite_v3_Async::getFd */
+
+/*------------------------------------------------------------------------------
+  Start
+  Trigger a measurement and return without waiting for it.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  handler: called from dispatch() with the finished measurement
+  context: passed to 'handler'
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+
+  Returns 0 on success, or -1 if the device already has a measurement in
+  flight, all LLv3_ASYNC_MAX_OPS are in use or the trigger write failed.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Async::start(LLv3_AsyncHandler handler, void * context,
+                                __u8 lidarliteAddress)
+{
+    __u8  commandByte = 0x04;
+    __u32 acqUs = lidar->getPredictedAcqUs(lidarliteAddress);
+    Op *  op    = NULL;
+    __u8  i;
+
+    for (i=0 ; i<LLv3_ASYNC_MAX_OPS ; i++)
+    {
+        if (ops[i].active && ops[i].address == lidarliteAddress)
+            return -1;
+
+        if (!ops[i].active && op == NULL)
+            op = &ops[i];
+    }
+
+    if (op == NULL)
+        return -1;
+
+    if (lidar->i2cWrite(LLv3_ACQ_CMD, &commandByte, 1, lidarliteAddress) < 0)
+        return -1;
+
+    // Like LLv3_WAIT_PREDICT: first look after half the worst case time
+    op->active    = 1;
+    op->address   = lidarliteAddress;
+    op->trigger   = llv3_monotonicNs();
+    op->due       = op->trigger + (__u64) acqUs * 500;
+    op->deadline  = op->trigger + (__u64) (2 * acqUs + LLv3_DEADLINE_SLACK_US) * 1000;
+    op->backoffUs = LLv3_WAIT_POLL_US;
+    op->handler   = handler;
+    op->context   = context;
+
+    arm();
+
+    return 0;
+} /* LIDARLite_v3_Async::start */
+
+/*------------------------------------------------------------------------------
+  Cancel
+  Forget the measurement in flight on a device without calling its handler
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Async::cancel(__u8 lidarliteAddress)
+{
+    __u8 i;
+
+    for (i=0 ; i<LLv3_ASYNC_MAX_OPS ; i++)
+    {
+        if (ops[i].active && ops[i].address == lidarliteAddress)
+            ops[i].active = 0;
+    }
+
+    arm();
+} /* LIDARLite_v3_Async::cancel */
+
+/*------------------------------------------------------------------------------
+  Pending
+  Number of measurements in flight
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Async::pending(void)
+{
+    __u32 count = 0;
+    __u8  i;
+
+    for (i=0 ; i<LLv3_ASYNC_MAX_OPS ; i++)
+        count += ops[i].active;
+
+    return count;
+} /* LIDARLite_v3_Async::pending */
+
+/*------------------------------------------------------------------------------
+  Dispatch
+  Advance every measurement whose next check is due and call the handlers
+  of the ones that finished. Call when getFd() is readable; calling it at
+  other times is harmless. Returns the number of handlers called.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Async::dispatch(void)
+{
+    __u64 expirations;
+    __u64 now;
+    __u32 count = 0;
+    __u8  distBytes[2];
+    __u8  statusByte;
+    __u8  i;
+    Op *  op;
+
+    // Clear readability; EAGAIN just means we were called early
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        printf("Failed to read the measurement timer: %s\n", strerror(errno));
+
+    now = llv3_monotonicNs();
+
+    for (i=0 ; i<LLv3_ASYNC_MAX_OPS ; i++)
+    {
+        op = &ops[i];
+
+        if (!op->active || op->due > now)
+            continue;
+
+        if (lidar->i2cRead(LLv3_STATUS, &statusByte, 1, op->address) != 1)
+        {
+            complete(op, LLv3_ERR_BUS, 0, LLv3_STATUS_INVALID);
+            count++;
+        }
+        else if (statusByte & 0x01)
+        {
+            if (now >= op->deadline)
+            {
+                complete(op, LLv3_ERR_TIMEOUT, 0, LLv3_STATUS_INVALID);
+                count++;
+                continue;
+            }
+
+            op->due = now + (__u64) op->backoffUs * 1000;
+
+            op->backoffUs *= 2;
+            if (op->backoffUs > LLv3_WAIT_BACKOFF_MAX_US)
+                op->backoffUs = LLv3_WAIT_BACKOFF_MAX_US;
+        }
+        else if (lidar->i2cRead((LLv3_DISTANCE | 0x80), distBytes, 2, op->address) != 2)
+        {
+            complete(op, LLv3_ERR_BUS, 0, LLv3_STATUS_INVALID);
+            count++;
+        }
+        else
+        {
+            complete(op, LLv3_OK, (distBytes[0] << 8) | distBytes[1], statusByte);
+            count++;
+        }
+    }
+
+    arm();
+
+    return count;
+} /* LIDARLite_v3_Async::dispatch */
+
+/*------------------------------------------------------------------------------
+  Complete
+  Retire a measurement and call its handler. The slot is freed first so the
+  handler can start the next measurement.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Async::complete(Op * op, __s32 result, __u16 distance, __u8 status)
+{
+    LLv3_Sample sample;
+
+    sample.timestamp = llv3_monotonicNs();
+    sample.trigger   = op->trigger;
+    sample.distance  = distance;
+    sample.status    = status;
+    sample.address   = op->address;
+    sample.bus       = lidar->getBusNumber();
+    sample.signal    = 0;
+
+    op->active = 0;
+
+    if (op->handler)
+        op->handler(&sample, result, op->context);
+} /* LIDARLite_v3_Async::complete */
+
+/*------------------------------------------------------------------------------
+  Arm
+  Set the timer to the earliest check due, or disarm it when idle
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Async::arm(void)
+{
+    struct itimerspec spec;
+    __u64 now;
+    __u64 next = ~0ull;
+    __u64 delay;
+    __u8  i;
+
+    memset(&spec, 0, sizeof(spec));
+
+    for (i=0 ; i<LLv3_ASYNC_MAX_OPS ; i++)
+    {
+        if (ops[i].active && ops[i].due < next)
+            next = ops[i].due;
+    }
+
+    if (next != ~0ull)
+    {
+        now   = llv3_monotonicNs();
+        delay = (next > now) ? next - now : 1; // 0 would disarm
+
+        spec.it_value.tv_sec  = delay / 1000000000ull;
+        spec.it_value.tv_nsec = delay % 1000000000ull;
+    }
+
+    timerfd_settime(timerFd, 0, &spec, NULL);
+} /* LIDARLite_v3_Async::arm */
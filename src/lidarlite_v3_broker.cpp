@@ -0,0 +1,488 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Measurement broker
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <include/lidarlite_v3_broker.h>
+
+/*------------------------------------------------------------------------------
+  Seqlock Helpers
+  The writer makes the sequence number odd, stores the sample, then makes it
+  even again. A reader accepts a copy only if it saw the same even sequence
+  number before and after copying.
+------------------------------------------------------------------------------*/
+static void llv3_slotWrite(LLv3_BrokerSlot * slot, __u64 seqDone,
+                           const LLv3_Sample * sample)
+{
+    slot->seq.store(seqDone - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->sample = *sample;
+
+    slot->seq.store(seqDone, std::memory_order_release);
+}
+
+// Returns the sequence number the copy is valid for, or an odd value if
+// the slot changed while copying
+static __u64 llv3_slotRead(const LLv3_BrokerSlot * slot, LLv3_Sample * sample)
+{
+    __u64 before = slot->seq.load(std::memory_order_acquire);
+
+    if (before & 1)
+        return before;
+
+    *sample = slot->sample;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (slot->seq.load(std::memory_order_relaxed) != before)
+        return 1;
+
+    return before;
+}
+
+/*------------------------------------------------------------------------------
+  Broker Reclaim
+  Remove a segment left behind by a broker that exited without close(),
+  whatever its version. A running broker holds an exclusive lock on its
+  segment until close(), so a complete segment whose lock can be taken is
+  stale. The lock is kept until after the unlink, so two brokers starting
+  together cannot both reclaim it, and the name must still lead to the
+  locked segment, so a segment that already replaced it is left alone.
+
+  Returns 0 if the segment was removed, or -1 if it is in use.
+------------------------------------------------------------------------------*/
+static __s32 llv3_brokerReclaim(const char * shmName)
+{
+    struct stat locked;
+    struct stat current;
+    __s32 result = -1;
+    __s32 fd;
+    __s32 check;
+    void * map;
+    __u32 magic = 0;
+
+    if ((fd = shm_open(shmName, O_RDONLY, 0)) < 0)
+        return -1;
+
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0 && fstat(fd, &locked) == 0 &&
+        locked.st_size >= (off_t) sizeof(magic))
+    {
+        // The magic number comes first in every version of the layout and
+        // is only set once a segment is complete
+        map = mmap(NULL, sizeof(magic), PROT_READ, MAP_SHARED, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            magic = *(const __u32 *) map;
+            munmap(map, sizeof(magic));
+        }
+
+        if (magic == LLv3_BROKER_MAGIC && (check = shm_open(shmName, O_RDONLY, 0)) >= 0)
+        {
+            if (fstat(check, &current) == 0 &&
+                current.st_dev == locked.st_dev && current.st_ino == locked.st_ino &&
+                shm_unlink(shmName) == 0)
+                result = 0;
+
+            ::close(check);
+        }
+    }
+
+    ::close(fd);
+
+    return result;
+}
+
+/*------------------------------------------------------------------------------
+  Broker Constructor
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance used for all bus transfers
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Broker::LIDARLite_v3_Broker(LIDARLite_v3 * lidarlite)
+    : scheduler(lidarlite)
+{
+    shm        = NULL;
+    lockFd     = -1;
+    name[0]    = 0;
+    numSensors = 0;
+    started    = 0;
+}
+
+LIDARLite_v3_Broker::~LIDARLite_v3_Broker(void)
+{
+    close();
+}
+
+/*------------------------------------------------------------------------------
+  Broker Add Sensor
+  Register a sensor to acquire from. Returns 0 on success or -1 if full.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Broker::addSensor(__u8 lidarliteAddress)
+{
+    if (scheduler.addSensor(lidarliteAddress) < 0)
+        return -1;
+
+    addresses[numSensors++] = lidarliteAddress;
+
+    if (shm)
+    {
+        shm->addresses[numSensors - 1] = lidarliteAddress;
+        shm->numSensors = numSensors;
+    }
+
+    return 0;
+} /* LIDARLite_v3_Broker::addSensor */
+
+/*------------------------------------------------------------------------------
+  Broker Open
+  Create the shared memory segment clients connect to, and lock it until
+  close(). A segment of the same name is only replaced if no broker holds
+  its lock; one still in use, or taken by another broker starting at the
+  same time, makes open fail rather than two brokers write to it. Returns 0
+  on success or -1 on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Broker::open(const char * shmName)
+{
+    __s32 fd;
+    void * map;
+
+    close();
+
+    fd = shm_open(shmName, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0 && errno == EEXIST)
+    {
+        if (llv3_brokerReclaim(shmName) < 0)
+        {
+            printf("Broker shared memory %s is in use by another broker.\n", shmName);
+            return -1;
+        }
+
+        // Another broker reclaiming it at the same time may create it first
+        fd = shm_open(shmName, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+        if (fd < 0 && errno == EEXIST)
+        {
+            printf("Broker shared memory %s was taken by another broker.\n", shmName);
+            return -1;
+        }
+    }
+
+    if (fd < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to create the broker shared memory: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // Held until close(); a reclaim may hold it for a moment, but finds
+    // the segment incomplete and leaves it alone
+    flock(fd, LOCK_EX);
+
+    if (ftruncate(fd, sizeof(LLv3_BrokerShm)) < 0)
+    {
+        ::close(fd);
+        shm_unlink(shmName);
+        printf("Failed to size the broker shared memory.\n");
+        return -1;
+    }
+
+    map = mmap(NULL, sizeof(LLv3_BrokerShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED)
+    {
+        ::close(fd);
+        shm_unlink(shmName);
+        printf("Failed to map the broker shared memory.\n");
+        return -1;
+    }
+
+    shm    = (LLv3_BrokerShm *) map;
+    lockFd = fd;
+    memset((void *) shm, 0, sizeof(LLv3_BrokerShm));
+
+    shm->version    = LLv3_BROKER_VERSION;
+    shm->owner      = getpid();
+    shm->numSensors = numSensors;
+    memcpy(shm->addresses, addresses, numSensors);
+
+    // Clients treat the segment as ready once the magic number appears
+    std::atomic_thread_fence(std::memory_order_release);
+    shm->magic = LLv3_BROKER_MAGIC;
+
+    strncpy(name, shmName, sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+
+    return 0;
+} /* LIDARLite_v3_Broker::open */
+
+/*------------------------------------------------------------------------------
+  Broker Close
+  Unmap and remove the shared memory segment. Connected clients keep their
+  mapping but receive no further samples.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Broker::close(void)
+{
+    if (shm)
+    {
+        munmap((void *) shm, sizeof(LLv3_BrokerShm));
+        shm_unlink(name);
+        shm = NULL;
+
+        // Only now may another broker reclaim the name
+        ::close(lockFd);
+        lockFd = -1;
+    }
+} /* LIDARLite_v3_Broker::close */
+
+/*------------------------------------------------------------------------------
+  Publish
+  Store a sample as its sensor's latest value and append it to the ring
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Broker::publish(const LLv3_Sample * sample)
+{
+    LLv3_BrokerSlot * slot;
+    __u64 n;
+    __u8  i;
+
+    for (i=0 ; i<numSensors ; i++)
+    {
+        if (addresses[i] == sample->address)
+        {
+            slot = &shm->latest[i];
+            llv3_slotWrite(slot, slot->seq.load(std::memory_order_relaxed) + 2, sample);
+            break;
+        }
+    }
+
+    n    = shm->published.load(std::memory_order_relaxed);
+    slot = &shm->ring[n & (LLv3_BROKER_RING_SIZE - 1)];
+
+    llv3_slotWrite(slot, 2 * n + 2, sample);
+    shm->published.store(n + 1, std::memory_order_release);
+} /* LIDARLite_v3_Broker::publish */
+
+/*------------------------------------------------------------------------------
+  Broker Step
+  Run one scheduler pass and publish whatever it harvested. The first call
+  triggers all sensors. Returns the number of samples published.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Broker::step(void)
+{
+    LLv3_Sample samples[LLv3_SCHED_MAX_SENSORS];
+    __u32 count;
+    __u32 i;
+
+    if (shm == NULL)
+        return 0;
+
+    if (!started)
+    {
+        scheduler.start();
+        started = 1;
+    }
+
+    count = scheduler.poll(samples, LLv3_SCHED_MAX_SENSORS);
+
+    for (i=0 ; i<count ; i++)
+        publish(&samples[i]);
+
+    return count;
+} /* LIDARLite_v3_Broker::step */
+
+/*------------------------------------------------------------------------------
+  Broker Run
+  Acquire and publish until *running becomes false
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Broker::run(std::atomic<bool> * running)
+{
+    while (running->load(std::memory_order_relaxed))
+        step();
+} /* LIDARLite_v3_Broker::run */
+
+/*------------------------------------------------------------------------------
+  Client
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Client::LIDARLite_v3_Client(void)
+{
+    shm    = NULL;
+    cursor = 0;
+    lost   = 0;
+}
+
+LIDARLite_v3_Client::~LIDARLite_v3_Client(void)
+{
+    disconnect();
+}
+
+/*------------------------------------------------------------------------------
+  Client Connect
+  Map a broker's shared memory read-only. drain() starts with the next
+  sample published after connecting. Returns 0 on success or -1 on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Client::connect(const char * shmName)
+{
+    __s32 fd;
+    void * map;
+
+    disconnect();
+
+    if ((fd = shm_open(shmName, O_RDONLY, 0)) < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to open the broker shared memory");
+        return -1;
+    }
+
+    map = mmap(NULL, sizeof(LLv3_BrokerShm), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        printf("Failed to map the broker shared memory.\n");
+        return -1;
+    }
+
+    shm = (const LLv3_BrokerShm *) map;
+
+    if (shm->magic != LLv3_BROKER_MAGIC || shm->version != LLv3_BROKER_VERSION)
+    {
+        disconnect();
+        printf("Broker shared memory is not ready or has another version.\n");
+        return -1;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    cursor = shm->published.load(std::memory_order_acquire);
+    lost   = 0;
+
+    return 0;
+} /* LIDARLite_v3_Client::connect */
+
+void LIDARLite_v3_Client::disconnect(void)
+{
+    if (shm)
+    {
+        munmap((void *) shm, sizeof(LLv3_BrokerShm));
+        shm = NULL;
+    }
+} /* LIDARLite_v3_Client::disconnect */
+
+/*------------------------------------------------------------------------------
+  Client Get Latest
+  Copy the newest sample of one sensor. Returns 0 on success or -1 if the
+  sensor is unknown or has not produced a sample yet.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Client::getLatest(LLv3_Sample * sample, __u8 lidarliteAddress)
+{
+    __u64 seq;
+    __u8  i;
+
+    if (shm == NULL)
+        return -1;
+
+    for (i=0 ; i<shm->numSensors ; i++)
+    {
+        if (shm->addresses[i] != lidarliteAddress)
+            continue;
+
+        do
+        {
+            seq = llv3_slotRead(&shm->latest[i], sample);
+        } while (seq & 1);
+
+        return (seq == 0) ? -1 : 0;
+    }
+
+    return -1;
+} /* LIDARLite_v3_Client::getLatest */
+
+/*------------------------------------------------------------------------------
+  Client Read Distance
+  Newest distance of one sensor in cm, or 0 if none is available or the
+  newest measurement has LLv3_STATUS_UNUSABLE set. Unlike
+  LIDARLite_v3::readDistance this generates no bus traffic.
+------------------------------------------------------------------------------*/
+__u16 LIDARLite_v3_Client::readDistance(__u8 lidarliteAddress)
+{
+    LLv3_Sample sample;
+
+    if (getLatest(&sample, lidarliteAddress) < 0)
+        return 0;
+
+    // Not a distance: 0 from a failed measurement, 1 cm without a return
+    if (sample.status & LLv3_STATUS_UNUSABLE)
+        return 0;
+
+    return sample.distance;
+} /* LIDARLite_v3_Client::readDistance */
+
+/*------------------------------------------------------------------------------
+  Client Drain
+  Copy up to maxSamples samples published since the previous drain, oldest
+  first, without blocking. Samples the broker overwrote before they could
+  be read are skipped and counted by getLost(). Returns the number copied.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Client::drain(LLv3_Sample * samples, __u32 maxSamples)
+{
+    __u64 published;
+    __u64 seq;
+    __u32 count = 0;
+
+    if (shm == NULL)
+        return 0;
+
+    published = shm->published.load(std::memory_order_acquire);
+
+    // Everything older than one ring length is gone
+    if (published - cursor > LLv3_BROKER_RING_SIZE)
+    {
+        lost  += published - cursor - LLv3_BROKER_RING_SIZE;
+        cursor = published - LLv3_BROKER_RING_SIZE;
+    }
+
+    while (cursor < published && count < maxSamples)
+    {
+        seq = llv3_slotRead(&shm->ring[cursor & (LLv3_BROKER_RING_SIZE - 1)],
+                            &samples[count]);
+
+        if (seq == 2 * cursor + 2)
+            count++;
+        else
+            lost++; // Reused by the broker while we were reading
+
+        cursor++;
+    }
+
+    return count;
+} /* LIDARLite_v3_Client::drain */
+
+__u64 LIDARLite_v3_Client::getLost(void)
+{
+    return lost;
+} /* LIDARLite_v3_Client::getLost */
@@ -0,0 +1,245 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Correlation record analysis
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <include/lidarlite_v3_corr.h>
+
+// Noise floor used when the record is perfectly clean, in LSB
+#define LLv3_CORR_MIN_NOISE   1.0f
+
+// SNR below which a record gets no confidence, and at which it gets full
+#define LLv3_CORR_SNR_MIN     2.0f
+#define LLv3_CORR_SNR_FULL    20.0f
+
+/*------------------------------------------------------------------------------
+  Record Scan
+  Find the extreme values and the sum of squares of a record in one pass.
+  Eight samples are processed per step with SSE2 or NEON when available.
+------------------------------------------------------------------------------*/
+static void llv3_corrScan(const __s16 * record, __u16 count,
+                          __s16 * maxValue, __s16 * minValue, __u64 * sumSquares)
+{
+    __u16  i = 0;
+    __s16  hi = -32768;
+    __s16  lo = 32767;
+    __u64  sq = 0;
+
+#if defined(__SSE2__)
+    __m128i vmax = _mm_set1_epi16(-32768);
+    __m128i vmin = _mm_set1_epi16(32767);
+    __m128i vsq  = _mm_setzero_si128();
+    __s32   lanes[4];
+    __s16   words[8];
+    __u8    j;
+
+    for ( ; i + 8 <= count ; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) &record[i]);
+
+        vmax = _mm_max_epi16(vmax, v);
+        vmin = _mm_min_epi16(vmin, v);
+        // Correlation samples fit in 9 bits, so the 32-bit lanes cannot
+        // overflow for any record length the device can return
+        vsq  = _mm_add_epi32(vsq, _mm_madd_epi16(v, v));
+    }
+
+    _mm_storeu_si128((__m128i *) lanes, vsq);
+    sq = (__u64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    _mm_storeu_si128((__m128i *) words, vmax);
+    for (j=0 ; j<8 ; j++)
+        hi = (words[j] > hi) ? words[j] : hi;
+
+    _mm_storeu_si128((__m128i *) words, vmin);
+    for (j=0 ; j<8 ; j++)
+        lo = (words[j] < lo) ? words[j] : lo;
+#elif defined(__ARM_NEON)
+    int16x8_t vmax = vdupq_n_s16(-32768);
+    int16x8_t vmin = vdupq_n_s16(32767);
+    int32x4_t vsq  = vdupq_n_s32(0);
+    __s32     lanes[4];
+    __s16     words[8];
+    __u8      j;
+
+    for ( ; i + 8 <= count ; i += 8)
+    {
+        int16x8_t v = vld1q_s16(&record[i]);
+
+        vmax = vmaxq_s16(vmax, v);
+        vmin = vminq_s16(vmin, v);
+        vsq  = vmlal_s16(vsq, vget_low_s16(v), vget_low_s16(v));
+        vsq  = vmlal_s16(vsq, vget_high_s16(v), vget_high_s16(v));
+    }
+
+    vst1q_s32(lanes, vsq);
+    sq = (__u64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    vst1q_s16(words, vmax);
+    for (j=0 ; j<8 ; j++)
+        hi = (words[j] > hi) ? words[j] : hi;
+
+    vst1q_s16(words, vmin);
+    for (j=0 ; j<8 ; j++)
+        lo = (words[j] < lo) ? words[j] : lo;
+#endif
+
+    for ( ; i < count ; i++)
+    {
+        hi  = (record[i] > hi) ? record[i] : hi;
+        lo  = (record[i] < lo) ? record[i] : lo;
+        sq += (__s32) record[i] * record[i];
+    }
+
+    *maxValue   = hi;
+    *minValue   = lo;
+    *sumSquares = sq;
+}
+
+/*------------------------------------------------------------------------------
+  Analyze Correlation
+  Locate the zero crossing of a correlation record to a fraction of a sample
+  and grade how trustworthy it is.
+
+  Process
+  ------------------------------------------------------------------------------
+  1.  Find the positive and negative peaks
+  2.  Between the peaks, find the pair of samples where the sign flips and
+      interpolate linearly between them
+  3.  Estimate noise as the RMS of the samples outside the pulse, which spans
+      the peaks plus one peak spacing on either side
+  4.  Confidence combines the SNR with how symmetric the two peaks are
+
+  Parameters
+  ------------------------------------------------------------------------------
+  record: sign extended correlation values, as returned by correlationRecordRead
+  count:  number of values in the record
+  result: receives the analysis
+------------------------------------------------------------------------------*/
+void llv3_analyzeCorrelation(const __s16 * record, __u16 count,
+                             LLv3_CorrResult * result)
+{
+    __s16  maxValue;
+    __s16  minValue;
+    __u64  sumSquares;
+    __u64  pulseSquares = 0;
+    __u16  first;
+    __u16  last;
+    __u16  spacing;
+    __u16  i;
+    float  amplitude;
+    float  noise;
+    float  symmetry;
+    float  grade;
+
+    result->zeroCrossing = -1.0f;
+    result->confidence   = 0.0f;
+
+    if (count < 2)
+    {
+        result->peakPositive      = count ? record[0] : 0;
+        result->peakNegative      = count ? record[0] : 0;
+        result->peakPositiveIndex = 0;
+        result->peakNegativeIndex = 0;
+        result->noiseRms          = 0.0f;
+        result->snr               = 0.0f;
+        return;
+    }
+
+    llv3_corrScan(record, count, &maxValue, &minValue, &sumSquares);
+
+    // First occurrence of each peak
+    for (i=0 ; record[i] != maxValue ; i++);
+    result->peakPositiveIndex = i;
+    for (i=0 ; record[i] != minValue ; i++);
+    result->peakNegativeIndex = i;
+
+    result->peakPositive = maxValue;
+    result->peakNegative = minValue;
+
+    first = result->peakPositiveIndex;
+    last  = result->peakNegativeIndex;
+    if (first > last)
+    {
+        first = result->peakNegativeIndex;
+        last  = result->peakPositiveIndex;
+    }
+
+    // Zero crossing between the peaks
+    if (maxValue > 0 && minValue < 0)
+    {
+        for (i=first ; i<last ; i++)
+        {
+            if ((record[i] >= 0) != (record[i+1] >= 0))
+            {
+                result->zeroCrossing = i + (float) record[i] / (float) (record[i] - record[i+1]);
+                break;
+            }
+        }
+    }
+
+    // Noise from the samples outside the pulse
+    spacing = last - first;
+    first   = (first > spacing) ? first - spacing : 0;
+    last    = (last + spacing < count - 1) ? last + spacing : count - 1;
+
+    for (i=first ; i<=last ; i++)
+        pulseSquares += (__s32) record[i] * record[i];
+
+    if (count - (last - first + 1) > 0)
+        noise = sqrtf((float) (sumSquares - pulseSquares) / (count - (last - first + 1)));
+    else
+        noise = 0.0f;
+
+    result->noiseRms = noise;
+
+    if (noise < LLv3_CORR_MIN_NOISE)
+        noise = LLv3_CORR_MIN_NOISE;
+
+    amplitude   = 0.5f * ((float) maxValue - (float) minValue);
+    result->snr = amplitude / noise;
+
+    if (result->zeroCrossing < 0.0f)
+        return;
+
+    grade = (result->snr - LLv3_CORR_SNR_MIN) / (LLv3_CORR_SNR_FULL - LLv3_CORR_SNR_MIN);
+    grade = (grade < 0.0f) ? 0.0f : ((grade > 1.0f) ? 1.0f : grade);
+
+    symmetry = (maxValue < -minValue) ? (float) maxValue / (float) -minValue
+                                      : (float) -minValue / (float) maxValue;
+
+    result->confidence = grade * symmetry;
+} /* llv3_analyzeCorrelation */
+
+/*------------------------------------------------------------------------------
+  Analyze Correlation Batch
+  Analyze 'numRecords' records of 'count' values each, stored back to back.
+------------------------------------------------------------------------------*/
+void llv3_analyzeCorrelationBatch(const __s16 * records, __u16 count,
+                                  __u32 numRecords, LLv3_CorrResult * results)
+{
+    __u32 i;
+
+    for (i=0 ; i<numRecords ; i++)
+        llv3_analyzeCorrelation(&records[(__u64) i * count], count, &results[i]);
+} /* llv3_analyzeCorrelationBatch */
@@ -0,0 +1,344 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Streaming distance filters
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <math.h>
+
+#include <include/lidarlite_v3_filter.h>
+
+// Scales a median absolute deviation to a standard deviation estimate for
+// normally distributed noise
+#define LLv3_MAD_SCALE 1.4826f
+
+/*------------------------------------------------------------------------------
+  Median Filter
+  The window is kept twice: in arrival order, to know which value leaves
+  next, and sorted, so the median is a lookup. Each update removes one
+  value from the sorted copy and inserts one, O(windowSize).
+------------------------------------------------------------------------------*/
+LLv3_MedianFilter::LLv3_MedianFilter(__u8 windowSize)
+{
+    if (windowSize == 0)
+        windowSize = 1;
+    if (windowSize > LLv3_FILTER_WINDOW_MAX)
+        windowSize = LLv3_FILTER_WINDOW_MAX;
+
+    size = windowSize;
+    reset();
+}
+
+void LLv3_MedianFilter::reset(void)
+{
+    count = 0;
+    head  = 0;
+}
+
+float LLv3_MedianFilter::update(float value, __u64 timestamp)
+{
+    __u8 i;
+
+    (void) timestamp;
+
+    if (count == size)
+    {
+        // Drop the oldest value from the sorted copy
+        for (i=0 ; i<count-1 && sorted[i] != window[head] ; i++);
+        for ( ; i<count-1 ; i++)
+            sorted[i] = sorted[i+1];
+        count--;
+    }
+
+    window[head] = value;
+    head = (head + 1) % size;
+
+    // Insert the new value, shifting larger ones up
+    for (i=count ; i>0 && sorted[i-1] > value ; i--)
+        sorted[i] = sorted[i-1];
+    sorted[i] = value;
+    count++;
+
+    return median();
+}
+
+float LLv3_MedianFilter::median(void)
+{
+    if (count == 0)
+        return 0.0f;
+
+    if (count & 1)
+        return sorted[count / 2];
+
+    return 0.5f * (sorted[count / 2 - 1] + sorted[count / 2]);
+}
+
+__u8 LLv3_MedianFilter::getCount(void)
+{
+    return count;
+}
+
+// Window contents in ascending order, getCount() values
+const float * LLv3_MedianFilter::values(void)
+{
+    return sorted;
+}
+
+/*------------------------------------------------------------------------------
+  Hampel Filter
+------------------------------------------------------------------------------*/
+LLv3_HampelFilter::LLv3_HampelFilter(__u8 windowSize, float threshold)
+    : window(windowSize)
+{
+    this->threshold = threshold;
+    rejected        = 0;
+}
+
+void LLv3_HampelFilter::reset(void)
+{
+    window.reset();
+    rejected = 0;
+}
+
+float LLv3_HampelFilter::update(float value, __u64 timestamp)
+{
+    float         deviations[LLv3_FILTER_WINDOW_MAX];
+    const float * sorted;
+    float         med;
+    float         mad;
+    float         d;
+    __s16         n;
+    __s16         lo;
+    __s16         hi;
+    __s16         i;
+
+    med    = window.update(value, timestamp);
+    sorted = window.values();
+    n      = window.getCount();
+
+    // Absolute deviations from the median come out of the sorted window in
+    // ascending order by merging outwards from the median position
+    lo = n / 2;
+    hi = n / 2;
+    if (!(n & 1))
+        lo--;
+    else
+        hi++;
+
+    for (i=0 ; i<n ; i++)
+    {
+        if (hi >= n || (lo >= 0 && med - sorted[lo] <= sorted[hi] - med))
+            deviations[i] = med - sorted[lo--];
+        else
+            deviations[i] = sorted[hi++] - med;
+    }
+
+    if (n & 1)
+        mad = deviations[n / 2];
+    else
+        mad = 0.5f * (deviations[n / 2 - 1] + deviations[n / 2]);
+
+    d = fabsf(value - med);
+
+    if (d > threshold * LLv3_MAD_SCALE * mad)
+    {
+        rejected++;
+        return med;
+    }
+
+    return value;
+}
+
+// Number of values replaced by the median since the last reset
+__u32 LLv3_HampelFilter::getRejected(void)
+{
+    return rejected;
+}
+
+/*------------------------------------------------------------------------------
+  Exponential Moving Average
+------------------------------------------------------------------------------*/
+LLv3_EmaFilter::LLv3_EmaFilter(float alpha)
+{
+    this->alpha = alpha;
+    reset();
+}
+
+void LLv3_EmaFilter::reset(void)
+{
+    state  = 0.0f;
+    primed = 0;
+}
+
+float LLv3_EmaFilter::update(float value, __u64 timestamp)
+{
+    (void) timestamp;
+
+    if (!primed)
+    {
+        state  = value;
+        primed = 1;
+    }
+    else
+    {
+        state += alpha * (value - state);
+    }
+
+    return state;
+}
+
+/*------------------------------------------------------------------------------
+  Kalman Filter
+  State x = [distance, velocity] with x' = F x, F = [1 dt; 0 1], driven by
+  white acceleration noise. The time step comes from the sample timestamps,
+  so irregular sample spacing is handled.
+------------------------------------------------------------------------------*/
+LLv3_KalmanFilter::LLv3_KalmanFilter(float accelNoise, float measNoise)
+{
+    this->accelNoise = accelNoise;
+    this->measNoise  = measNoise;
+    reset();
+}
+
+void LLv3_KalmanFilter::reset(void)
+{
+    x[0]    = 0.0f;
+    x[1]    = 0.0f;
+    p[0][0] = 0.0f;
+    p[0][1] = 0.0f;
+    p[1][0] = 0.0f;
+    p[1][1] = 0.0f;
+    lastStamp = 0;
+    primed    = 0;
+}
+
+float LLv3_KalmanFilter::update(float value, __u64 timestamp)
+{
+    float dt;
+    float dt2;
+    float y;
+    float s;
+    float k0;
+    float k1;
+    float p00;
+    float p01;
+    float p10;
+    float p11;
+
+    if (!primed)
+    {
+        x[0]      = value;
+        x[1]      = 0.0f;
+        p[0][0]   = measNoise;
+        p[1][1]   = 1.0e6f; // Velocity unknown
+        lastStamp = timestamp;
+        primed    = 1;
+        return value;
+    }
+
+    dt        = (timestamp > lastStamp) ? (timestamp - lastStamp) * 1.0e-9f : 0.0f;
+    dt2       = dt * dt;
+    lastStamp = timestamp;
+
+    // Predict
+    x[0] += dt * x[1];
+
+    p00 = p[0][0] + dt * (p[1][0] + p[0][1]) + dt2 * p[1][1] + 0.25f * dt2 * dt2 * accelNoise;
+    p01 = p[0][1] + dt * p[1][1]                              + 0.5f  * dt2 * dt  * accelNoise;
+    p10 = p[1][0] + dt * p[1][1]                              + 0.5f  * dt2 * dt  * accelNoise;
+    p11 = p[1][1]                                             +         dt2       * accelNoise;
+
+    // Update with the measured distance
+    y  = value - x[0];
+    s  = p00 + measNoise;
+    k0 = p00 / s;
+    k1 = p10 / s;
+
+    x[0] += k0 * y;
+    x[1] += k1 * y;
+
+    p[0][0] = (1.0f - k0) * p00;
+    p[0][1] = (1.0f - k0) * p01;
+    p[1][0] = p10 - k1 * p00;
+    p[1][1] = p11 - k1 * p01;
+
+    return x[0];
+}
+
+// Estimated rate of change of distance, cm/s
+float LLv3_KalmanFilter::velocity(void)
+{
+    return x[1];
+}
+
+/*------------------------------------------------------------------------------
+  Filter Pipeline
+------------------------------------------------------------------------------*/
+LLv3_FilterPipeline::LLv3_FilterPipeline(void)
+{
+    numStages = 0;
+    output    = 0.0f;
+}
+
+/*------------------------------------------------------------------------------
+  Add Stage
+  Append a stage; samples pass through stages in the order they were added.
+  The stage is not copied and must outlive the pipeline. Returns 0 on
+  success or -1 if the pipeline is full.
+------------------------------------------------------------------------------*/
+__s32 LLv3_FilterPipeline::addStage(LLv3_Filter * stage)
+{
+    if (numStages == LLv3_PIPELINE_MAX_STAGES)
+        return -1;
+
+    stages[numStages++] = stage;
+
+    return 0;
+}
+
+float LLv3_FilterPipeline::update(float value, __u64 timestamp)
+{
+    __u8 i;
+
+    for (i=0 ; i<numStages ; i++)
+        value = stages[i]->update(value, timestamp);
+
+    output = value;
+
+    return value;
+}
+
+/*------------------------------------------------------------------------------
+  Update (sample)
+  Feed the distance of a sample. The distance of a sample with
+  LLv3_STATUS_UNUSABLE set is 0 or a placeholder, not a measurement; such a
+  sample leaves the stages alone and the last output is returned again.
+------------------------------------------------------------------------------*/
+float LLv3_FilterPipeline::update(const LLv3_Sample * sample)
+{
+    if (sample->status & LLv3_STATUS_UNUSABLE)
+        return output;
+
+    return update((float) sample->distance, sample->timestamp);
+}
+
+void LLv3_FilterPipeline::reset(void)
+{
+    __u8 i;
+
+    output = 0.0f;
+
+    for (i=0 ; i<numStages ; i++)
+        stages[i]->reset();
+}
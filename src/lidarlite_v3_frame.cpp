@@ -0,0 +1,228 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Multi-sensor frame assembly
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <string.h>
+
+#include <include/lidarlite_v3_frame.h>
+
+LIDARLite_v3_FrameAssembler::LIDARLite_v3_FrameAssembler(void)
+{
+    numSensors = 0;
+    reset();
+}
+
+/*------------------------------------------------------------------------------
+  Add Sensor
+  Include a sensor in every frame. Returns 0 on success or -1 if full.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_FrameAssembler::addSensor(__u8 lidarliteAddress)
+{
+    if (numSensors == LLv3_FRAME_MAX_SENSORS)
+        return -1;
+
+    addresses[numSensors] = lidarliteAddress;
+    memset(&history[numSensors], 0, sizeof(History));
+    numSensors++;
+
+    return 0;
+} /* LIDARLite_v3_FrameAssembler::addSensor */
+
+/*------------------------------------------------------------------------------
+  Reset
+  Drop all buffered samples and statistics, e.g. after a pause in acquisition
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_FrameAssembler::reset(void)
+{
+    memset(history, 0, sizeof(history));
+    fresh         = 0;
+    sequence      = 0;
+    frames        = 0;
+    maxSpreadNs   = 0;
+    extrapolated  = 0;
+    spreadSumNs   = 0;
+    durationSumNs = 0;
+    durations     = 0;
+} /* LIDARLite_v3_FrameAssembler::reset */
+
+/*------------------------------------------------------------------------------
+  Push
+  Add one sample, e.g. from LIDARLite_v3_Scheduler::poll. Samples of each
+  sensor must arrive in time order; samples of unknown sensors are ignored.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  sample: the new sample
+  frame:  receives the frame completed by this sample, if any
+
+  Returns 1 if a frame was written to 'frame', otherwise 0.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_FrameAssembler::push(const LLv3_Sample * sample, LLv3_Frame * frame)
+{
+    History * h;
+    __u64 time;
+    __u64 oldest;
+    __u64 newest;
+    __u8  sensor;
+    __u8  slot;
+    __u8  i;
+
+    for (sensor=0 ; sensor<numSensors ; sensor++)
+    {
+        if (addresses[sensor] == sample->address)
+            break;
+    }
+
+    if (sensor == numSensors)
+        return 0;
+
+    time = sample->timestamp;
+
+    if (sample->trigger && sample->trigger < sample->timestamp)
+    {
+        time -= (sample->timestamp - sample->trigger) / 2;
+
+        durationSumNs += sample->timestamp - sample->trigger;
+        durations++;
+    }
+
+    h    = &history[sensor];
+    slot = (h->count == 0) ? 0 : (h->newest + 1) % LLv3_FRAME_HISTORY;
+
+    h->time[slot]     = time;
+    h->distance[slot] = sample->distance;
+    h->valid[slot]    = !(sample->status & LLv3_STATUS_UNUSABLE);
+    h->newest         = slot;
+
+    if (h->count < LLv3_FRAME_HISTORY)
+        h->count++;
+
+    fresh |= (1u << sensor);
+
+    if (fresh != (1u << numSensors) - 1)
+        return 0;
+
+    // Every sensor has a new sample; align them all to the earliest
+    oldest = ~0ull;
+    newest = 0;
+
+    for (i=0 ; i<numSensors ; i++)
+    {
+        time = history[i].time[history[i].newest];
+
+        if (time < oldest)
+            oldest = time;
+        if (time > newest)
+            newest = time;
+    }
+
+    frame->sequence   = sequence++;
+    frame->timestamp  = oldest;
+    frame->spreadNs   = newest - oldest;
+    frame->numSensors = numSensors;
+
+    for (i=0 ; i<numSensors ; i++)
+        interpolate(i, oldest, frame);
+
+    frames++;
+    spreadSumNs += frame->spreadNs;
+    if (frame->spreadNs > maxSpreadNs)
+        maxSpreadNs = frame->spreadNs;
+
+    fresh = 0;
+
+    return 1;
+} /* LIDARLite_v3_FrameAssembler::push */
+
+/*------------------------------------------------------------------------------
+  Interpolate
+  Fill in one sensor's entry of a frame at 'time'. Uses the pair of valid
+  samples around 'time', or the valid sample closest to it if there is no
+  such pair.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_FrameAssembler::interpolate(__u8 sensor, __u64 time, LLv3_Frame * frame)
+{
+    History * h = &history[sensor];
+    __s32 before = -1; // Newest valid sample at or before 'time'
+    __s32 after  = -1; // Oldest valid sample after 'time'
+    __s32 slot;
+    __u8  i;
+    float t;
+
+    frame->addresses[sensor] = addresses[sensor];
+    frame->offsetNs[sensor]  = (__s64) (h->time[h->newest] - time);
+
+    // Walk from the newest sample back in time
+    for (i=0 ; i<h->count ; i++)
+    {
+        slot = (h->newest + LLv3_FRAME_HISTORY - i) % LLv3_FRAME_HISTORY;
+
+        if (!h->valid[slot])
+            continue;
+
+        if (h->time[slot] > time)
+        {
+            after = slot;
+        }
+        else
+        {
+            before = slot;
+            break;
+        }
+    }
+
+    if (before >= 0 && after >= 0)
+    {
+        t = (float) (time - h->time[before]) / (float) (h->time[after] - h->time[before]);
+
+        frame->distance[sensor] = h->distance[before] + t * (h->distance[after] - h->distance[before]);
+        frame->valid[sensor]    = 1;
+        return;
+    }
+
+    if (before >= 0 && h->time[before] == time)
+    {
+        frame->distance[sensor] = h->distance[before];
+        frame->valid[sensor]    = 1;
+        return;
+    }
+
+    slot = (before >= 0) ? before : after;
+
+    if (slot < 0)
+    {
+        frame->distance[sensor] = 0;
+        frame->valid[sensor]    = 0;
+        return;
+    }
+
+    frame->distance[sensor] = h->distance[slot];
+    frame->valid[sensor]    = 1;
+    extrapolated++;
+} /* LIDARLite_v3_FrameAssembler::interpolate */
+
+/*------------------------------------------------------------------------------
+  Get Skew Stats
+  Report how far apart the sensors' measurements were before alignment
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_FrameAssembler::getSkewStats(LLv3_SkewStats * stats)
+{
+    stats->frames         = frames;
+    stats->maxSpreadNs    = maxSpreadNs;
+    stats->meanSpreadNs   = frames ? spreadSumNs / frames : 0;
+    stats->meanDurationNs = durations ? durationSumNs / durations : 0;
+    stats->extrapolated   = extrapolated;
+} /* LIDARLite_v3_FrameAssembler::getSkewStats */
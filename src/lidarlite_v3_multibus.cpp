@@ -0,0 +1,263 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Parallel acquisition on several I2C buses
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <include/lidarlite_v3_multibus.h>
+
+/*------------------------------------------------------------------------------
+  Constructor
+------------------------------------------------------------------------------*/
+LIDARLite_v3_MultiBus::LIDARLite_v3_MultiBus(void) : running(false)
+{
+    numBuses = 0;
+    nextBus  = 0;
+}
+
+LIDARLite_v3_MultiBus::~LIDARLite_v3_MultiBus(void)
+{
+    __u8 i;
+
+    stop();
+
+    for (i=0 ; i<numBuses ; i++)
+        delete workers[i];
+}
+
+/*------------------------------------------------------------------------------
+  Add Bus
+  Open a bus and give it an acquisition thread. Configure its sensors
+  through getLidar() before start().
+
+  Parameters
+  ------------------------------------------------------------------------------
+  busNumber: N of /dev/i2c-N
+  cpu: core the bus's thread is pinned to, or -1 to let the kernel choose
+  fifoPriority: 1 to 99 to run the thread under SCHED_FIFO at that
+    priority, which needs CAP_SYS_NICE; 0 keeps the default policy
+
+  Returns the bus index used by addSensor and getLidar, or -1 if all
+  LLv3_MULTIBUS_MAX_BUSES are in use, the bus could not be opened or the
+  set is running.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_MultiBus::addBus(__u8 busNumber, __s32 cpu, __s32 fifoPriority)
+{
+    Worker * worker;
+
+    if (numBuses == LLv3_MULTIBUS_MAX_BUSES || running.load())
+        return -1;
+
+    worker = new Worker;
+
+    if (worker->lidar.i2c_init(busNumber) < 0)
+    {
+        delete worker;
+        return -1;
+    }
+
+    worker->cpu      = cpu;
+    worker->priority = fifoPriority;
+
+    workers[numBuses] = worker;
+
+    return numBuses++;
+} /* LIDARLite_v3_MultiBus::addBus */
+
+/*------------------------------------------------------------------------------
+  Add Sensor
+  Register a sensor on a bus by its I2C address. Returns 0 on success or -1
+  if the bus index is unknown, its scheduler is full or the set is running.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_MultiBus::addSensor(__u8 busIndex, __u8 lidarliteAddress)
+{
+    if (busIndex >= numBuses || running.load())
+        return -1;
+
+    return workers[busIndex]->scheduler.addSensor(lidarliteAddress);
+} /* LIDARLite_v3_MultiBus::addSensor */
+
+/*------------------------------------------------------------------------------
+  Get Lidar
+  The LIDARLite_v3 instance that owns a bus, for configuring its sensors.
+  While the set is running it belongs to the bus's thread; do not call into
+  it from other threads. Returns NULL if the bus index is unknown.
+------------------------------------------------------------------------------*/
+LIDARLite_v3 * LIDARLite_v3_MultiBus::getLidar(__u8 busIndex)
+{
+    if (busIndex >= numBuses)
+        return NULL;
+
+    return &workers[busIndex]->lidar;
+} /* LIDARLite_v3_MultiBus::getLidar */
+
+__u8 LIDARLite_v3_MultiBus::getBusCount(void)
+{
+    return numBuses;
+} /* LIDARLite_v3_MultiBus::getBusCount */
+
+/*------------------------------------------------------------------------------
+  Start
+  Launch one acquisition thread per bus. Returns 0 on success or -1 if the
+  set is already running.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_MultiBus::start(void)
+{
+    __u8 i;
+
+    if (running.exchange(true))
+        return -1;
+
+    for (i=0 ; i<numBuses ; i++)
+        workers[i]->thread = std::thread(&LIDARLite_v3_MultiBus::run, this, workers[i]);
+
+    return 0;
+} /* LIDARLite_v3_MultiBus::start */
+
+/*------------------------------------------------------------------------------
+  Stop
+  Ask every acquisition thread to exit and wait for them. Samples still
+  buffered remain available to drain().
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_MultiBus::stop(void)
+{
+    __u8 i;
+
+    running.store(false);
+
+    for (i=0 ; i<numBuses ; i++)
+    {
+        if (workers[i]->thread.joinable())
+            workers[i]->thread.join();
+    }
+} /* LIDARLite_v3_MultiBus::stop */
+
+/*------------------------------------------------------------------------------
+  Drain
+  Copy up to maxSamples buffered samples from all buses without blocking.
+  Buses are visited in turn, starting after the one visited first last
+  time, so a busy bus cannot starve the others when maxSamples is small.
+  Samples of one bus stay in order; samples of different buses are ordered
+  only by their timestamps. Must only be called from a single consumer
+  thread. Returns the number of samples copied.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_MultiBus::drain(LLv3_Sample * samples, __u32 maxSamples)
+{
+    __u32 count = 0;
+    __u8  i;
+
+    if (numBuses == 0)
+        return 0;
+
+    for (i=0 ; i<numBuses && count<maxSamples ; i++)
+        count += workers[(nextBus + i) % numBuses]->ring.pop(&samples[count], maxSamples - count);
+
+    nextBus = (nextBus + 1) % numBuses;
+
+    return count;
+} /* LIDARLite_v3_MultiBus::drain */
+
+/*------------------------------------------------------------------------------
+  Get Sample Count
+  Number of samples a bus has acquired since it was added, including any
+  dropped as overruns
+------------------------------------------------------------------------------*/
+__u64 LIDARLite_v3_MultiBus::getSampleCount(__u8 busIndex)
+{
+    if (busIndex >= numBuses)
+        return 0;
+
+    return workers[busIndex]->samples.load(std::memory_order_relaxed);
+} /* LIDARLite_v3_MultiBus::getSampleCount */
+
+/*------------------------------------------------------------------------------
+  Get Overruns
+  Number of samples dropped on all buses because their ring was full
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_MultiBus::getOverruns(void)
+{
+    __u32 total = 0;
+    __u8  i;
+
+    for (i=0 ; i<numBuses ; i++)
+        total += workers[i]->overruns.load(std::memory_order_relaxed);
+
+    return total;
+} /* LIDARLite_v3_MultiBus::getOverruns */
+
+/*------------------------------------------------------------------------------
+  Run
+  Acquisition loop of one bus. The thread applies its own core affinity and
+  scheduling policy, then keeps every sensor on the bus measuring with the
+  scheduler and pushes each harvested sample to the bus's ring. Failing to
+  pin or raise priority is reported and acquisition goes on without it.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_MultiBus::run(Worker * worker)
+{
+    LLv3_Sample        samples[LLv3_SCHED_MAX_SENSORS];
+    struct sched_param param;
+    cpu_set_t          cpus;
+    __u32              count;
+    __u32              i;
+    __s32              err;
+
+    if (worker->cpu >= 0)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(worker->cpu, &cpus);
+
+        if ((err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0)
+        {
+            //ERROR HANDLING: usually a core that does not exist
+            printf("Failed to pin bus %d to core %d: %s\n",
+                   worker->lidar.getBusNumber(), worker->cpu, strerror(err));
+        }
+    }
+
+    if (worker->priority > 0)
+    {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = worker->priority;
+
+        if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0)
+        {
+            //ERROR HANDLING: usually missing CAP_SYS_NICE or RLIMIT_RTPRIO
+            printf("Failed to set SCHED_FIFO for bus %d: %s\n",
+                   worker->lidar.getBusNumber(), strerror(err));
+        }
+    }
+
+    if (worker->scheduler.getSensorCount() == 0)
+        return;
+
+    worker->scheduler.start();
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        count = worker->scheduler.poll(samples, LLv3_SCHED_MAX_SENSORS);
+
+        for (i=0 ; i<count ; i++)
+        {
+            if (!worker->ring.push(samples[i]))
+                worker->overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        worker->samples.fetch_add(count, std::memory_order_relaxed);
+    }
+} /* LIDARLite_v3_MultiBus::run */
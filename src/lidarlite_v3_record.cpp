@@ -0,0 +1,394 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Session recording and replay
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <include/lidarlite_v3_record.h>
+#include <include/lidarlite_v3_sweep.h>
+
+// Size of the stdio buffer used by the recorder
+#define LLv3_REC_BUFFER_SIZE 65536
+
+/*------------------------------------------------------------------------------
+  Recorder
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Recorder::LIDARLite_v3_Recorder(void)
+{
+    file = NULL;
+}
+
+LIDARLite_v3_Recorder::~LIDARLite_v3_Recorder(void)
+{
+    close();
+}
+
+/*------------------------------------------------------------------------------
+  Recorder Open
+  Create (or truncate) a recording and write its file header. Records are
+  buffered and reach the file in large writes. Returns 0 on success or -1 on
+  failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Recorder::open(const char * path)
+{
+    __u8 header[LLv3_REC_HEADER_SIZE] = {0};
+
+    close();
+
+    if ((file = fopen(path, "wb")) == NULL)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to open the recording file");
+        return -1;
+    }
+
+    setvbuf(file, NULL, _IOFBF, LLv3_REC_BUFFER_SIZE);
+
+    memcpy(header, LLv3_REC_MAGIC, 7);
+    header[7] = LLv3_REC_VERSION;
+    fwrite(header, 1, sizeof(header), file);
+
+    return 0;
+} /* LIDARLite_v3_Recorder::open */
+
+/*------------------------------------------------------------------------------
+  Recorder Close
+  Flush buffered records and close the file
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Recorder::close(void)
+{
+    if (file)
+    {
+        fclose(file);
+        file = NULL;
+    }
+} /* LIDARLite_v3_Recorder::close */
+
+/*------------------------------------------------------------------------------
+  Log Record
+  Append one record whose payload is the concatenation of 'numParts'
+  buffers, followed by padding
+------------------------------------------------------------------------------*/
+static void llv3_logRecordParts(FILE * file, __u8 type, __u8 address, __u8 regAddr,
+                                __u8 failed, const void * const * parts,
+                                const __u16 * lengths, __u8 numParts)
+{
+    static const __u8 padding[8] = {0};
+    LLv3_RecordHeader header;
+    __u16 length = 0;
+    __u8  i;
+
+    if (file == NULL)
+        return;
+
+    for (i=0 ; i<numParts ; i++)
+        length += lengths[i];
+
+    header.timestamp = llv3_monotonicNs();
+    header.type      = type;
+    header.address   = address;
+    header.regAddr   = regAddr;
+    header.failed    = failed;
+    header.length    = length;
+    header.reserved  = 0;
+
+    fwrite(&header, 1, sizeof(header), file);
+    for (i=0 ; i<numParts ; i++)
+        fwrite(parts[i], 1, lengths[i], file);
+    fwrite(padding, 1, (8 - (length & 7)) & 7, file);
+}
+
+static void llv3_logRecord(FILE * file, __u8 type, __u8 address, __u8 regAddr,
+                           __u8 failed, const void * payload, __u16 length)
+{
+    llv3_logRecordParts(file, type, address, regAddr, failed, &payload, &length, 1);
+}
+
+/*------------------------------------------------------------------------------
+  Log Transfer
+  Record a register transaction (LLv3_REC_WRITE or LLv3_REC_READ)
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Recorder::logTransfer(__u8 type, __u8 address, __u8 regAddr,
+                                        const __u8 * dataBytes, __u16 numBytes,
+                                        __u8 failed)
+{
+    llv3_logRecord(file, type, address, regAddr, failed, dataBytes, numBytes);
+} /* LIDARLite_v3_Recorder::logTransfer */
+
+/*------------------------------------------------------------------------------
+  Log Sample
+  Record a decoded distance measurement
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Recorder::logSample(const LLv3_Sample * sample)
+{
+    llv3_logRecord(file, LLv3_REC_SAMPLE, sample->address, 0, 0,
+                   sample, sizeof(LLv3_Sample));
+} /* LIDARLite_v3_Recorder::logSample */
+
+/*------------------------------------------------------------------------------
+  Log Correlation
+  Record a decoded correlation record
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Recorder::logCorrelation(__u8 address, const __s16 * values,
+                                           __u16 count)
+{
+    llv3_logRecord(file, LLv3_REC_CORRELATION, address, 0, 0,
+                   values, count * sizeof(__s16));
+} /* LIDARLite_v3_Recorder::logCorrelation */
+
+/*------------------------------------------------------------------------------
+  Log Scan
+  Record the Cartesian points of a scan frame from LIDARLite_v3_Sweep
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Recorder::logScan(const LLv3_ScanFrame * frame)
+{
+    static_assert(sizeof(LLv3_ScanRecord) + 3 * LLv3_SCAN_MAX_POINTS * sizeof(float) <= 0xffff,
+                  "a full scan must fit one record");
+
+    LLv3_ScanRecord scan;
+    const void *    parts[4];
+    __u16           lengths[4];
+
+    scan.sequence  = frame->sequence;
+    scan.startTime = frame->startTime;
+    scan.endTime   = frame->endTime;
+    scan.numPoints = frame->numPoints;
+    scan.dropped   = frame->dropped;
+
+    parts[0] = &scan;
+    parts[1] = frame->x;
+    parts[2] = frame->y;
+    parts[3] = frame->z;
+
+    lengths[0] = sizeof(scan);
+    lengths[1] = lengths[2] = lengths[3] = frame->numPoints * sizeof(float);
+
+    llv3_logRecordParts(file, LLv3_REC_SCAN, frame->address, 0, 0, parts, lengths, 4);
+} /* LIDARLite_v3_Recorder::logScan */
+
+/*------------------------------------------------------------------------------
+  Replay
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Replay::LIDARLite_v3_Replay(void)
+{
+    base       = NULL;
+    size       = 0;
+    cursor     = 0;
+    realtime   = 0;
+    firstStamp = 0;
+    startTime  = 0;
+}
+
+LIDARLite_v3_Replay::~LIDARLite_v3_Replay(void)
+{
+    close();
+}
+
+/*------------------------------------------------------------------------------
+  Replay Open
+  Memory-map a recording and check its header. Returns 0 on success or -1
+  on failure.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Replay::open(const char * path)
+{
+    struct stat info;
+    __s32       fd;
+    void *      map;
+
+    close();
+
+    if ((fd = ::open(path, O_RDONLY)) < 0)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to open the recording file");
+        return -1;
+    }
+
+    if (fstat(fd, &info) < 0 || info.st_size < LLv3_REC_HEADER_SIZE)
+    {
+        ::close(fd);
+        printf("Recording file is too short.\n");
+        return -1;
+    }
+
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        printf("Failed to map the recording file.\n");
+        return -1;
+    }
+
+    if (memcmp(map, LLv3_REC_MAGIC, 7) != 0 ||
+        ((const __u8 *) map)[7] != LLv3_REC_VERSION)
+    {
+        munmap(map, info.st_size);
+        printf("Not a LIDAR-Lite recording.\n");
+        return -1;
+    }
+
+    base = (const __u8 *) map;
+    size = info.st_size;
+
+    rewind();
+
+    if (size >= LLv3_REC_HEADER_SIZE + sizeof(LLv3_RecordHeader))
+        firstStamp = ((const LLv3_RecordHeader *) (base + LLv3_REC_HEADER_SIZE))->timestamp;
+
+    return 0;
+} /* LIDARLite_v3_Replay::open */
+
+void LIDARLite_v3_Replay::close(void)
+{
+    if (base)
+    {
+        munmap((void *) base, size);
+        base = NULL;
+        size = 0;
+    }
+} /* LIDARLite_v3_Replay::close */
+
+/*------------------------------------------------------------------------------
+  Rewind
+  Restart replay from the first record
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Replay::rewind(void)
+{
+    cursor    = LLv3_REC_HEADER_SIZE;
+    startTime = 0;
+} /* LIDARLite_v3_Replay::rewind */
+
+/*------------------------------------------------------------------------------
+  Set Realtime
+  A non-zero value paces reads to the recorded timestamps. By default
+  transactions are replayed as fast as the caller issues them.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Replay::setRealtime(__u8 enable)
+{
+    realtime = enable;
+} /* LIDARLite_v3_Replay::setRealtime */
+
+/*------------------------------------------------------------------------------
+  Next
+  Return the next record in the mapping and point 'payload' at its data, or
+  return NULL at the end of the recording. Records are not copied.
+------------------------------------------------------------------------------*/
+const LLv3_RecordHeader * LIDARLite_v3_Replay::next(const __u8 ** payload)
+{
+    const LLv3_RecordHeader * header;
+
+    if (base == NULL || cursor + sizeof(LLv3_RecordHeader) > size)
+        return NULL;
+
+    header = (const LLv3_RecordHeader *) (base + cursor);
+
+    if (cursor + sizeof(LLv3_RecordHeader) + header->length > size)
+        return NULL; // Truncated final record
+
+    *payload = base + cursor + sizeof(LLv3_RecordHeader);
+    cursor  += sizeof(LLv3_RecordHeader) + ((header->length + 7) & ~7);
+
+    return header;
+} /* LIDARLite_v3_Replay::next */
+
+/*------------------------------------------------------------------------------
+  Pace
+  In realtime mode, sleep until the recorded offset of 'timestamp' has
+  elapsed since replay began
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Replay::pace(__u64 timestamp)
+{
+    struct timespec delay;
+    __u64 now = llv3_monotonicNs();
+    __u64 due;
+
+    if (startTime == 0)
+        startTime = now;
+
+    if (!realtime)
+        return;
+
+    due = startTime + (timestamp - firstStamp);
+
+    if (due > now)
+    {
+        delay.tv_sec  = (due - now) / 1000000000ull;
+        delay.tv_nsec = (due - now) % 1000000000ull;
+        nanosleep(&delay, NULL);
+    }
+} /* LIDARLite_v3_Replay::pace */
+
+/*------------------------------------------------------------------------------
+  Replay Read
+  Stand-in for LIDARLite_v3::i2cRead. Skips forward to the next recorded read
+  of the same register on the same device and returns its data. Returns the
+  number of bytes copied, or -1 if the recorded read failed or there is no
+  such read left. In the latter case the cursor stays where it was, so
+  later reads of other registers still find their records.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Replay::read(__u8 regAddr, __u8 * dataBytes,
+                                __u8 numBytes, __u8 lidarliteAddress)
+{
+    const LLv3_RecordHeader * header;
+    const __u8 *              payload;
+    __u64                     saved = cursor;
+
+    while ((header = next(&payload)) != NULL)
+    {
+        if (header->type    != LLv3_REC_READ   ||
+            header->address != lidarliteAddress ||
+            header->regAddr != regAddr)
+            continue;
+
+        pace(header->timestamp);
+
+        if (header->failed)
+            return -1;
+
+        if (header->length < numBytes)
+            numBytes = header->length;
+
+        memcpy(dataBytes, payload, numBytes);
+
+        return numBytes;
+    }
+
+    cursor = saved;
+
+    return -1;
+} /* LIDARLite_v3_Replay::read */
+
+/*------------------------------------------------------------------------------
+  Replay Write
+  Stand-in for LIDARLite_v3::i2cWrite. Writes do not change what the
+  recording returns, so they are accepted without moving the cursor.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Replay::write(__u8 regAddr, __u8 * dataBytes,
+                                 __u8 numBytes, __u8 lidarliteAddress)
+{
+    (void) regAddr;
+    (void) dataBytes;
+    (void) lidarliteAddress;
+
+    return numBytes;
+} /* LIDARLite_v3_Replay::write */
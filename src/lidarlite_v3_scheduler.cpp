@@ -0,0 +1,130 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Multi-sensor scheduler
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3_scheduler.h>
+
+/*------------------------------------------------------------------------------
+  Constructor
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance used for all bus transfers
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Scheduler::LIDARLite_v3_Scheduler(LIDARLite_v3 * lidarlite)
+{
+    lidar      = lidarlite;
+    numSensors = 0;
+    nextSensor = 0;
+}
+
+/*------------------------------------------------------------------------------
+  Add Sensor
+  Register a sensor by its I2C address (see setI2Caddr for giving each unit
+  its own address). Returns 0 on success or -1 if the scheduler is full.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Scheduler::addSensor(__u8 lidarliteAddress)
+{
+    if (numSensors == LLv3_SCHED_MAX_SENSORS)
+        return -1;
+
+    addresses[numSensors++] = lidarliteAddress;
+
+    return 0;
+} /* LIDARLite_v3_Scheduler::addSensor */
+
+__u8 LIDARLite_v3_Scheduler::getSensorCount(void)
+{
+    return numSensors;
+} /* LIDARLite_v3_Scheduler::getSensorCount */
+
+/*------------------------------------------------------------------------------
+  Start
+  Trigger a measurement on every registered sensor back to back, so that all
+  of them integrate at the same time.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Scheduler::start(void)
+{
+    __u8 i;
+
+    for (i=0 ; i<numSensors ; i++)
+    {
+        lidar->takeRange(addresses[i]);
+        triggerNs[i] = llv3_monotonicNs();
+        busyNs[i]    = triggerNs[i];
+    }
+} /* LIDARLite_v3_Scheduler::start */
+
+/*------------------------------------------------------------------------------
+  Poll
+  Make one pass over the sensors. Every sensor that reports not busy is
+  re-triggered immediately and the distance of its finished measurement is
+  read, while the remaining sensors keep integrating. Sensors that are still
+  busy cost a single status read. The pass starts where the previous one
+  stopped so that no sensor is starved when maxSamples is small.
+
+  Each sample carries the time its measurement was triggered and an
+  estimate of when it completed: halfway between the last status read that
+  still saw the sensor busy and the one that saw it done.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  samples:    array to receive harvested samples
+  maxSamples: capacity of 'samples'
+
+  Returns the number of samples harvested during this pass.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Scheduler::poll(LLv3_Sample * samples, __u32 maxSamples)
+{
+    __u32 count = 0;
+    __u64 now;
+    __u8  checked;
+    __u8  status;
+    __u8  sensor;
+
+    for (checked=0 ; checked<numSensors && count<maxSamples ; checked++)
+    {
+        sensor     = nextSensor;
+        nextSensor = (nextSensor + 1) % numSensors;
+
+        now    = llv3_monotonicNs();
+        status = lidar->getStatus(addresses[sensor]);
+
+        if (status & 0x01)
+        {
+            busyNs[sensor] = now;
+            continue;
+        }
+
+        samples[count].timestamp = busyNs[sensor] + (now - busyNs[sensor]) / 2;
+        samples[count].trigger   = triggerNs[sensor];
+        samples[count].status    = status;
+        samples[count].address   = addresses[sensor];
+        samples[count].bus       = lidar->getBusNumber();
+        samples[count].signal    = 0;
+
+        lidar->takeRange(addresses[sensor]);
+        triggerNs[sensor] = llv3_monotonicNs();
+        busyNs[sensor]    = triggerNs[sensor];
+
+        samples[count].distance  = lidar->readDistance(addresses[sensor]);
+
+        count++;
+    }
+
+    return count;
+} /* LIDARLite_v3_Scheduler::poll */
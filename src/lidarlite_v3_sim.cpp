@@ -0,0 +1,637 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Simulated bus transport and LIDAR-Lite v3 register model
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_sim.h>
+
+// Register read after CORR_DATA to get the sign of the current sample
+#define LLv3_CORR_DATA_SIGN (LLv3_CORR_DATA + 1)
+
+/*------------------------------------------------------------------------------
+  Correlation Sample
+  Synthetic correlation record: a derivative-of-Gaussian pulse, positive lobe
+  first, whose zero crossing moves later with distance
+------------------------------------------------------------------------------*/
+static __s16 llv3_simCorrelation(__u16 index, __u16 distance)
+{
+    float center = 20.0f + distance / 8.0f;
+    float t;
+    float v;
+
+    if (center > LLv3_SIM_CORR_SIZE - 20)
+        center = LLv3_SIM_CORR_SIZE - 20;
+
+    t = (index - center) / 4.0f;
+    v = -200.0f * t * expf(0.5f - 0.5f * t * t);
+
+    return (__s16) lrintf(v);
+}
+
+/*------------------------------------------------------------------------------
+  Signal
+  Return signal strength of a measurement with 'sigCountMax' acquisitions
+  of a target at 'distance' cm, before clamping to the 8-bit register
+------------------------------------------------------------------------------*/
+static float llv3_simSignal(__u8 sigCountMax, __u16 distance)
+{
+    float ratio = (float) LLv3_SIM_MAX_RANGE_CM / ((distance > 0) ? distance : 1);
+
+    return LLv3_SIM_SIGNAL_MIN * (sigCountMax / 255.0f) * ratio * ratio;
+}
+
+/*------------------------------------------------------------------------------
+  Gaussian
+  Standard normal random number (Box-Muller on a xorshift generator)
+------------------------------------------------------------------------------*/
+static float llv3_simGaussian(__u32 * state)
+{
+    float u[2];
+    __u8  i;
+
+    for (i=0 ; i<2 ; i++)
+    {
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        u[i] = (*state + 1.0f) / 4294967296.0f;
+    }
+
+    return sqrtf(-2.0f * logf(u[0])) * cosf(6.2831853f * u[1]);
+}
+
+/*------------------------------------------------------------------------------
+  Wait Until
+  Return at llv3_monotonicNs() time 'until'. Spinning keeps simulated bus
+  time exact; with 'sleep' set the thread sleeps instead, as it would in
+  the kernel while a real controller clocks the bits out, at the cost of
+  wakeup latency.
+------------------------------------------------------------------------------*/
+static void llv3_simWaitUntil(__u64 until, __u8 sleep)
+{
+    struct timespec at;
+    __u64 now = llv3_monotonicNs();
+    __u64 wake;
+
+    if (until <= now)
+        return;
+
+    if (sleep)
+    {
+        // clock_nanosleep does not take CLOCK_MONOTONIC_RAW; carry the
+        // remaining time over to CLOCK_MONOTONIC
+        clock_gettime(CLOCK_MONOTONIC, &at);
+        wake = (__u64) at.tv_sec * 1000000000ull + at.tv_nsec + (until - now);
+
+        at.tv_sec  = wake / 1000000000ull;
+        at.tv_nsec = wake % 1000000000ull;
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+    }
+
+    while (llv3_monotonicNs() < until);
+}
+
+/*------------------------------------------------------------------------------
+  Model
+------------------------------------------------------------------------------*/
+LLv3_SimModel::LLv3_SimModel(void)
+{
+    numDevices = 0;
+    busClockHz = 0;
+    busFreeAt  = 0;
+    busSleep   = 0;
+}
+
+/*------------------------------------------------------------------------------
+  Get
+  Return the model behind a simulated bus number, or NULL if out of range
+------------------------------------------------------------------------------*/
+LLv3_SimModel * LLv3_SimModel::get(__u8 busNumber)
+{
+    static LLv3_SimModel models[LLv3_SIM_MAX_BUSES];
+
+    if (busNumber >= LLv3_SIM_MAX_BUSES)
+        return NULL;
+
+    return &models[busNumber];
+} /* LLv3_SimModel::get */
+
+/*------------------------------------------------------------------------------
+  Add Device
+  Attach a simulated LIDAR-Lite to the bus. With the default address 0x62
+  the unit starts out as after power-up; with any other address it behaves
+  as if setI2Caddr had already moved it there with the default disabled.
+  Returns the device index or -1 if the bus is full.
+------------------------------------------------------------------------------*/
+__s32 LLv3_SimModel::addDevice(__u8 address, __u16 unitId)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    LLv3_SimDevice * device;
+
+    if (numDevices == LLv3_SIM_MAX_DEVICES)
+        return -1;
+
+    device           = &devices[numDevices];
+    device->unitId   = unitId;
+    device->distance   = 0;
+    device->noiseCm    = 0.0f;
+    device->noiseState = 0x9e3779b9u ^ unitId;
+    resetDevice(device);
+
+    if (address != LIDARLITE_ADDR_DEFAULT)
+    {
+        device->secondaryAddress = address;
+        device->secondaryEnabled = 1;
+        device->defaultDisabled  = 1;
+    }
+
+    return numDevices++;
+} /* LLv3_SimModel::addDevice */
+
+void LLv3_SimModel::removeAll(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    numDevices = 0;
+} /* LLv3_SimModel::removeAll */
+
+/*------------------------------------------------------------------------------
+  Set Distance
+  Set the target distance, in cm, seen by the device answering at 'address'.
+  Takes effect from the next measurement.
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::setDistance(__u8 address, __u16 distance)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    LLv3_SimDevice * device = find(address);
+
+    if (device)
+        device->distance = distance;
+} /* LLv3_SimModel::setDistance */
+
+/*------------------------------------------------------------------------------
+  Set Noise
+  Give the distances of the device answering at 'address' Gaussian noise
+  with a standard deviation of 'noiseCm' at the detection limit, shrinking
+  with the square root of the signal strength above it. The default of 0
+  reports distances exactly.
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::setNoise(__u8 address, float noiseCm)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    LLv3_SimDevice * device = find(address);
+
+    if (device)
+        device->noiseCm = noiseCm;
+} /* LLv3_SimModel::setNoise */
+
+/*------------------------------------------------------------------------------
+  Set Bus Clock
+  Make every transfer occupy the bus for the time it would take at 'hz'
+  (9 clocks per byte, including the address byte of every message). The
+  default of 0 makes transfers instantaneous.
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::setBusClock(__u32 hz)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    busClockHz = hz;
+} /* LLv3_SimModel::setBusClock */
+
+/*------------------------------------------------------------------------------
+  Set Bus Sleep
+  Choose how a thread waits out the bus time of its transfer. The default
+  spins, keeping simulated timing exact. Sleeping lets threads driving
+  other simulated buses run meanwhile, as on real hardware, which matters
+  when there are more buses than cores; each transfer then also takes the
+  host's wakeup latency.
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::setBusSleep(__u8 enable)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    busSleep = enable;
+} /* LLv3_SimModel::setBusSleep */
+
+/*------------------------------------------------------------------------------
+  Power Cycle
+  Simulate a brownout of the device answering at 'address': all registers,
+  including the secondary address, return to their power-up values, and any
+  measurement in progress is lost.
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::powerCycle(__u8 address)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    LLv3_SimDevice * device = find(address);
+
+    if (device)
+        resetDevice(device);
+} /* LLv3_SimModel::powerCycle */
+
+/*------------------------------------------------------------------------------
+  Wait Mode Pin
+  Block until the mode pin of a device in status output mode falls, i.e.
+  its measurement is done, like LLv3_WAIT_GPIO does on an edge event. The
+  pin says nothing about the result; STATUS has to be read for that.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  address:  device address
+  deadline: llv3_monotonicNs() time to give up at, 0 waits forever
+
+  Returns 0 once the pin is low, -1 at the deadline or -2 if no device
+  answers at 'address'.
+------------------------------------------------------------------------------*/
+__s32 LLv3_SimModel::waitModePin(__u8 address, __u64 deadline)
+{
+    LLv3_SimDevice * device;
+    __u64 until;
+
+    while (1)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            if ((device = find(address)) == NULL)
+                return -2;
+
+            until = device->busyUntil;
+        }
+
+        if (llv3_monotonicNs() >= until)
+            return 0;
+
+        if (deadline && llv3_monotonicNs() >= deadline)
+            return -1;
+
+        llv3_simWaitUntil((deadline && deadline < until) ? deadline : until, 1);
+    }
+} /* LLv3_SimModel::waitModePin */
+
+/*------------------------------------------------------------------------------
+  Reset Device
+  Return a device to its power-up register values, as a write of 0x00 to
+  ACQ_CMD does on the real unit
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::resetDevice(LLv3_SimDevice * device)
+{
+    memset(device->regs, 0, sizeof(device->regs));
+
+    device->regs[LLv3_SIG_CNT_VAL]   = 0x80;
+    device->regs[LLv3_ACQ_CONFIG]    = 0x08;
+    device->regs[LLv3_REF_CNT_VAL]   = 0x05;
+    device->regs[LLv3_UNIT_ID_HIGH]  = device->unitId >> 8;
+    device->regs[LLv3_UNIT_ID_LOW]   = device->unitId & 0xff;
+
+    device->regPointer       = 0;
+    device->autoIncrement    = 0;
+    device->secondaryAddress = 0;
+    device->secondaryEnabled = 0;
+    device->defaultDisabled  = 0;
+    device->testMode         = 0;
+    device->corrIndex        = 0;
+    device->busyUntil        = 0;
+    device->pending          = 0;
+} /* LLv3_SimModel::resetDevice */
+
+/*------------------------------------------------------------------------------
+  Find
+  Return the device that acknowledges 'address', or NULL
+------------------------------------------------------------------------------*/
+LLv3_SimDevice * LLv3_SimModel::find(__u8 address)
+{
+    __u8 i;
+
+    for (i=0 ; i<numDevices ; i++)
+    {
+        if ((address == LIDARLITE_ADDR_DEFAULT && !devices[i].defaultDisabled) ||
+            (address == devices[i].secondaryAddress && devices[i].secondaryEnabled))
+            return &devices[i];
+    }
+
+    return NULL;
+} /* LLv3_SimModel::find */
+
+/*------------------------------------------------------------------------------
+  Update
+  Publish the result of a measurement once its acquisition time has passed
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::update(LLv3_SimDevice * device)
+{
+    float signal;
+    float measured;
+
+    if (device->pending && llv3_monotonicNs() >= device->busyUntil)
+    {
+        signal   = llv3_simSignal(device->regs[LLv3_SIG_CNT_VAL], device->distance);
+        measured = device->distance;
+
+        if (signal < LLv3_SIM_SIGNAL_MIN)
+        {
+            // No return detected; the device reports a 1 cm distance
+            device->regs[LLv3_STATUS] = LLv3_STATUS_NO_SIGNAL;
+            measured = 1.0f;
+        }
+        else
+        {
+            device->regs[LLv3_STATUS] = 0x00;
+
+            if (device->noiseCm > 0.0f)
+                measured += device->noiseCm * sqrtf(LLv3_SIM_SIGNAL_MIN / signal) *
+                            llv3_simGaussian(&device->noiseState);
+        }
+
+        if (measured < 1.0f)
+            measured = 1.0f;
+        if (measured > 0xffff)
+            measured = 0xffff;
+
+        device->regs[LLv3_PEAK_CORR]       = (signal < 255.0f) ? (__u8) signal : 255;
+        device->regs[LLv3_NOISE_PEAK]      = LLv3_SIM_SIGNAL_MIN / 2;
+        device->regs[LLv3_SIGNAL_STRENGTH] = (signal < 255.0f) ? (__u8) signal : 255;
+        device->regs[LLv3_DISTANCE]        = (__u16) lrintf(measured) >> 8;
+        device->regs[LLv3_DISTANCE + 1]    = (__u16) lrintf(measured) & 0xff;
+        device->pending = 0;
+    }
+} /* LLv3_SimModel::update */
+
+/*------------------------------------------------------------------------------
+  Write Register
+------------------------------------------------------------------------------*/
+void LLv3_SimModel::writeReg(LLv3_SimDevice * device, __u8 regAddr, __u8 value)
+{
+    __u32 acqUs;
+
+    update(device);
+
+    switch (regAddr)
+    {
+        case LLv3_ACQ_CMD:
+            if (value == 0x00)
+            {
+                resetDevice(device);
+                break;
+            }
+
+            // Quick termination (ACQ_CONFIG bit 3 clear) is modeled as
+            // ending halfway through the maximum acquisition count
+            acqUs = llv3_acqTimeUs(device->regs[LLv3_SIG_CNT_VAL],
+                                   device->regs[LLv3_REF_CNT_VAL]);
+            if (!(device->regs[LLv3_ACQ_CONFIG] & 0x08))
+                acqUs /= 2;
+
+            device->busyUntil = llv3_monotonicNs() + (__u64) acqUs * 1000;
+            device->pending   = 1;
+            break;
+
+        case LLv3_I2C_SEC_ADR:
+            // Only accepted after the serial number was echoed into I2C_ID
+            device->regs[regAddr] = value;
+            if (device->regs[LLv3_I2C_ID_HIGH] == device->regs[LLv3_UNIT_ID_HIGH] &&
+                device->regs[LLv3_I2C_ID_LOW]  == device->regs[LLv3_UNIT_ID_LOW])
+                device->secondaryAddress = value;
+            break;
+
+        case LLv3_I2C_CONFIG:
+            device->regs[regAddr] = value;
+            if (device->secondaryAddress)
+                device->secondaryEnabled = 1;
+            device->defaultDisabled = (value & 0x08) ? 1 : 0;
+            break;
+
+        case LLv3_COMMAND:
+            device->regs[regAddr] = value;
+            device->testMode  = (value == 0x07);
+            device->corrIndex = 0;
+            break;
+
+        case LLv3_STATUS:
+        case LLv3_UNIT_ID_HIGH:
+        case LLv3_UNIT_ID_LOW:
+            break; // Read only
+
+        default:
+            device->regs[regAddr] = value;
+            break;
+    }
+} /* LLv3_SimModel::writeReg */
+
+/*------------------------------------------------------------------------------
+  Read Register
+------------------------------------------------------------------------------*/
+__u8 LLv3_SimModel::readReg(LLv3_SimDevice * device, __u8 regAddr)
+{
+    __s16 sample;
+
+    update(device);
+
+    switch (regAddr)
+    {
+        case LLv3_STATUS:
+            // Flags other than busy describe the last completed measurement
+            return ((llv3_monotonicNs() < device->busyUntil) ? 0x01 : 0x00) |
+                   device->regs[LLv3_STATUS];
+
+        case LLv3_CORR_DATA:
+            if (!device->testMode)
+                return 0;
+            sample = llv3_simCorrelation(device->corrIndex, device->distance);
+            return sample & 0xff;
+
+        case LLv3_CORR_DATA_SIGN:
+            if (!device->testMode)
+                return 0;
+            sample = llv3_simCorrelation(device->corrIndex, device->distance);
+            device->corrIndex = (device->corrIndex + 1) % LLv3_SIM_CORR_SIZE;
+            return (sample < 0) ? 0xff : 0x00;
+
+        default:
+            return device->regs[regAddr];
+    }
+} /* LLv3_SimModel::readReg */
+
+/*------------------------------------------------------------------------------
+  Transfer
+  Execute a sequence of messages atomically, as one ioctl(I2C_RDWR) would.
+  A write message sets the register pointer from its first byte (bit 7
+  selects auto-increment) and writes any remaining bytes. A read message
+  returns bytes from the register pointer. Returns numMsgs, or -1 with errno
+  set to EREMOTEIO when no device acknowledges an address.
+------------------------------------------------------------------------------*/
+__s32 LLv3_SimModel::transfer(struct i2c_msg * msgs, __u32 numMsgs)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    LLv3_SimDevice * device;
+    __u64 bits = 0;
+    __u64 start;
+    __u32 i;
+    __u16 j;
+
+    for (i=0 ; i<numMsgs ; i++)
+        bits += 9 * (msgs[i].len + 1);
+
+    // Occupy the bus for the duration of the transfer, starting when the
+    // previous transfer ended if that is still in the future
+    if (busClockHz)
+    {
+        start     = llv3_monotonicNs();
+        if (busFreeAt > start)
+            start = busFreeAt;
+        busFreeAt = start + bits * 1000000000ull / busClockHz;
+
+        llv3_simWaitUntil(busFreeAt, busSleep);
+    }
+
+    for (i=0 ; i<numMsgs ; i++)
+    {
+        if ((device = find(msgs[i].addr)) == NULL)
+        {
+            errno = EREMOTEIO;
+            return -1;
+        }
+
+        if (msgs[i].flags & I2C_M_RD)
+        {
+            for (j=0 ; j<msgs[i].len ; j++)
+            {
+                msgs[i].buf[j] = readReg(device, device->regPointer);
+                if (device->autoIncrement)
+                    device->regPointer++;
+            }
+        }
+        else if (msgs[i].len)
+        {
+            device->regPointer    = msgs[i].buf[0] & 0x7f;
+            device->autoIncrement = msgs[i].buf[0] & 0x80;
+
+            for (j=1 ; j<msgs[i].len ; j++)
+            {
+                writeReg(device, device->regPointer, msgs[i].buf[j]);
+                if (device->autoIncrement)
+                    device->regPointer++;
+            }
+        }
+    }
+
+    return numMsgs;
+} /* LLv3_SimModel::transfer */
+
+/*------------------------------------------------------------------------------
+  Bus
+  Same interface as LLv3_I2cDevBus. Every call counts as the one system call
+  the i2c-dev transport would have made.
+------------------------------------------------------------------------------*/
+LLv3_SimBus::LLv3_SimBus(void)
+{
+    model    = NULL;
+    slave    = 0;
+    syscalls = 0;
+}
+
+__s32 LLv3_SimBus::open(__u8 busNumber)
+{
+    syscalls++;
+    model = LLv3_SimModel::get(busNumber);
+
+    if (model == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    return 0;
+}
+
+void LLv3_SimBus::close(void)
+{
+    if (model)
+    {
+        syscalls++;
+        model = NULL;
+    }
+}
+
+__s32 LLv3_SimBus::setSlave(__u8 address)
+{
+    syscalls++;
+    slave = address;
+
+    return 0;
+}
+
+__s32 LLv3_SimBus::write(const __u8 * buffer, __u16 numBytes)
+{
+    struct i2c_msg msg;
+
+    syscalls++;
+
+    if (model == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    msg.addr  = slave;
+    msg.flags = 0;
+    msg.len   = numBytes;
+    msg.buf   = (__u8 *) buffer;
+
+    return (model->transfer(&msg, 1) < 0) ? -1 : numBytes;
+}
+
+__s32 LLv3_SimBus::read(__u8 * buffer, __u16 numBytes)
+{
+    struct i2c_msg msg;
+
+    syscalls++;
+
+    if (model == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    msg.addr  = slave;
+    msg.flags = I2C_M_RD;
+    msg.len   = numBytes;
+    msg.buf   = buffer;
+
+    return (model->transfer(&msg, 1) < 0) ? -1 : numBytes;
+}
+
+__s32 LLv3_SimBus::transfer(struct i2c_msg * msgs, __u32 numMsgs)
+{
+    syscalls++;
+
+    if (model == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return model->transfer(msgs, numMsgs);
+}
+
+__u32 LLv3_SimBus::getSyscalls(void)
+{
+    return syscalls;
+}
@@ -0,0 +1,171 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Transfer instrumentation: counters, latency histograms and an error trace
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <string.h>
+
+#include <include/lidarlite_v3_stats.h>
+
+LLv3_Stats::LLv3_Stats(void)
+{
+    reset();
+}
+
+/*------------------------------------------------------------------------------
+  Reset
+  Clear all counters and the error trace. Call from the owning thread only.
+------------------------------------------------------------------------------*/
+void LLv3_Stats::reset(void)
+{
+    __u32 i;
+    __u32 j;
+
+    for (i=0 ; i<LLv3_STATS_NUM_REGS ; i++)
+    {
+        regReads[i].store(0, std::memory_order_relaxed);
+        regWrites[i].store(0, std::memory_order_relaxed);
+    }
+
+    for (i=0 ; i<LLv3_NUM_OPS ; i++)
+    {
+        ops[i].store(0, std::memory_order_relaxed);
+        failures[i].store(0, std::memory_order_relaxed);
+        latencyNs[i].store(0, std::memory_order_relaxed);
+
+        for (j=0 ; j<LLv3_STATS_HIST_BINS ; j++)
+            histogram[i][j].store(0, std::memory_order_relaxed);
+    }
+
+    retries.store(0, std::memory_order_relaxed);
+    errorHead.store(0, std::memory_order_release);
+} /* LLv3_Stats::reset */
+
+/*------------------------------------------------------------------------------
+  Record Error
+  Append a failed operation to the error trace, overwriting the oldest entry
+  once LLv3_STATS_ERROR_RING entries are held. The operation has already
+  been traced by the caller.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  op:        LLv3_OP_* of the failed operation
+  regAddr:   register the operation addressed
+  address:   device address
+  error:     errno at the time of the failure
+  timestamp: llv3_monotonicNs() at the time of the failure
+------------------------------------------------------------------------------*/
+void LLv3_Stats::recordError(__u8 op, __u8 regAddr, __u8 address,
+                             __s32 error, __u64 timestamp)
+{
+    __u64 head = errorHead.load(std::memory_order_relaxed);
+    LLv3_StatsError * entry = &errors[head & (LLv3_STATS_ERROR_RING - 1)];
+
+    entry->timestamp = timestamp;
+    entry->error     = error;
+    entry->op        = op;
+    entry->regAddr   = regAddr;
+    entry->address   = address;
+
+    errorHead.store(head + 1, std::memory_order_release);
+} /* LLv3_Stats::recordError */
+
+/*------------------------------------------------------------------------------
+  Snapshot
+  Copy all counters and the error trace into 'out'. Safe to call from any
+  thread while the owner keeps updating; counters may be a few operations
+  apart from each other, and error entries overwritten while copying are
+  dropped.
+------------------------------------------------------------------------------*/
+void LLv3_Stats::snapshot(LLv3_StatsSnapshot * out) const
+{
+    __u64 before;
+    __u64 after;
+    __u64 first;
+    __u64 n;
+    __u32 i;
+    __u32 j;
+
+    for (i=0 ; i<LLv3_STATS_NUM_REGS ; i++)
+    {
+        out->regReads[i]  = regReads[i].load(std::memory_order_relaxed);
+        out->regWrites[i] = regWrites[i].load(std::memory_order_relaxed);
+    }
+
+    for (i=0 ; i<LLv3_NUM_OPS ; i++)
+    {
+        out->ops[i]       = ops[i].load(std::memory_order_relaxed);
+        out->failures[i]  = failures[i].load(std::memory_order_relaxed);
+        out->latencyNs[i] = latencyNs[i].load(std::memory_order_relaxed);
+
+        for (j=0 ; j<LLv3_STATS_HIST_BINS ; j++)
+            out->histogram[i][j] = histogram[i][j].load(std::memory_order_relaxed);
+    }
+
+    out->retries = retries.load(std::memory_order_relaxed);
+
+    before = errorHead.load(std::memory_order_acquire);
+    first  = (before > LLv3_STATS_ERROR_RING) ? before - LLv3_STATS_ERROR_RING : 0;
+
+    for (n=first ; n<before ; n++)
+        out->errors[n - first] = errors[n & (LLv3_STATS_ERROR_RING - 1)];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = errorHead.load(std::memory_order_relaxed);
+
+    // Entries the writer reused while we copied are unreliable
+    if (after - first > LLv3_STATS_ERROR_RING)
+    {
+        n = after - first - LLv3_STATS_ERROR_RING;
+
+        if (n > before - first)
+            n = before - first;
+
+        memmove(out->errors, &out->errors[n], (before - first - n) * sizeof(LLv3_StatsError));
+        first += n;
+    }
+
+    out->errorsTotal = before;
+    out->numErrors   = before - first;
+} /* LLv3_Stats::snapshot */
+
+/*------------------------------------------------------------------------------
+  Percentile
+  Estimate a latency percentile of one operation type from its histogram
+------------------------------------------------------------------------------*/
+__u64 llv3_statsPercentileNs(const LLv3_StatsSnapshot * snap, __u8 op, double fraction)
+{
+    __u64 target;
+    __u64 seen = 0;
+    __u32 i;
+
+    if (snap->ops[op] == 0)
+        return 0;
+
+    target = (__u64) (fraction * snap->ops[op]);
+
+    if (target == 0)
+        target = 1;
+
+    for (i=0 ; i<LLv3_STATS_HIST_BINS ; i++)
+    {
+        seen += snap->histogram[op][i];
+
+        if (seen >= target)
+            return 2ull << i;
+    }
+
+    return 2ull << (LLv3_STATS_HIST_BINS - 1);
+} /* llv3_statsPercentileNs */
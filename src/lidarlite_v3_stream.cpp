@@ -0,0 +1,109 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Continuous ranging engine
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+
+#include <include/lidarlite_v3_stream.h>
+
+/*------------------------------------------------------------------------------
+  Constructor
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance. While the stream is running
+    the acquisition thread owns it; do not call into it from other threads.
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Stream::LIDARLite_v3_Stream(LIDARLite_v3 * lidarlite,
+                                         __u8 lidarliteAddress)
+    : lidar(lidarlite), address(lidarliteAddress), running(false), overruns(0)
+{
+}
+
+LIDARLite_v3_Stream::~LIDARLite_v3_Stream(void)
+{
+    stop();
+}
+
+/*------------------------------------------------------------------------------
+  Start
+  Launch the acquisition thread. Returns 0 on success or -1 if the stream is
+  already running.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Stream::start(void)
+{
+    if (running.exchange(true))
+        return -1;
+
+    worker = std::thread(&LIDARLite_v3_Stream::run, this);
+
+    return 0;
+} /* LIDARLite_v3_Stream::start */
+
+/*------------------------------------------------------------------------------
+  Stop
+  Ask the acquisition thread to exit and wait for it. Samples still in the
+  ring remain available to drain().
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Stream::stop(void)
+{
+    running.store(false);
+
+    if (worker.joinable())
+        worker.join();
+} /* LIDARLite_v3_Stream::stop */
+
+/*------------------------------------------------------------------------------
+  Drain
+  Copy up to maxSamples buffered samples, oldest first, without blocking.
+  Must only be called from a single consumer thread. Returns the number of
+  samples copied.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Stream::drain(LLv3_Sample * samples, __u32 maxSamples)
+{
+    return ring.pop(samples, maxSamples);
+} /* LIDARLite_v3_Stream::drain */
+
+/*------------------------------------------------------------------------------
+  Get Overruns
+  Number of samples dropped because the ring was full when they completed.
+------------------------------------------------------------------------------*/
+__u32 LIDARLite_v3_Stream::getOverruns(void)
+{
+    return overruns.load(std::memory_order_relaxed);
+} /* LIDARLite_v3_Stream::getOverruns */
+
+/*------------------------------------------------------------------------------
+  Run
+  Acquisition loop. Measurements go through LIDARLite_v3::measure, so the
+  device waits as selected with setWaitPolicy and failed attempts are
+  retried as set with setRetryPolicy. Measurements that still fail are
+  dropped rather than pushed with a placeholder distance.
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Stream::run(void)
+{
+    LLv3_Sample sample;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (lidar->measure(&sample, address) != LLv3_OK)
+            continue;
+
+        if (!ring.push(sample))
+            overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+} /* LIDARLite_v3_Stream::run */
@@ -0,0 +1,460 @@
+/*------------------------------------------------------------------------------
+  LIDARLite_v3 Raspberry Pi Library
+  Point cloud sweeps with a pan/tilt scanned sensor
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <include/lidarlite_v3_sweep.h>
+
+/*------------------------------------------------------------------------------
+  Sine and Cosine
+  The angle is reduced by the nearest multiple q of pi/2 (pi/2 split in three
+  parts so the reduction stays exact), both functions are evaluated on the
+  remainder in [-pi/4, pi/4] with minimax polynomials, and q mod 4 selects
+  which result goes where and with which sign:
+
+    q mod 4    0        1        2        3
+    sin        sin(r)   cos(r)  -sin(r)  -cos(r)
+    cos        cos(r)  -sin(r)  -cos(r)   sin(r)
+------------------------------------------------------------------------------*/
+#define LLv3_2_OVER_PI 0.636619772367581f
+#define LLv3_PIO2_A    1.5703125f
+#define LLv3_PIO2_B    4.837512969970703e-4f
+#define LLv3_PIO2_C    7.549790126404332e-8f
+
+#define LLv3_SIN_P0   -1.9515295891e-4f
+#define LLv3_SIN_P1    8.3321608736e-3f
+#define LLv3_SIN_P2   -1.6666654611e-1f
+#define LLv3_COS_P0    2.443315711809948e-5f
+#define LLv3_COS_P1   -1.388731625493765e-3f
+#define LLv3_COS_P2    4.166664568298827e-2f
+
+void llv3_sincos(float angle, float * sine, float * cosine)
+{
+    __s32 q  = (__s32) lrintf(angle * LLv3_2_OVER_PI);
+    float qf = (float) q;
+    float r  = ((angle - qf * LLv3_PIO2_A) - qf * LLv3_PIO2_B) - qf * LLv3_PIO2_C;
+    float r2 = r * r;
+    float s  = ((LLv3_SIN_P0 * r2 + LLv3_SIN_P1) * r2 + LLv3_SIN_P2) * r2 * r + r;
+    float c  = ((LLv3_COS_P0 * r2 + LLv3_COS_P1) * r2 + LLv3_COS_P2) * r2 * r2 - 0.5f * r2 + 1.0f;
+
+    if (q & 1)
+    {
+        float t = s;
+        s = c;
+        c = t;
+    }
+
+    *sine   = (q & 2)       ? -s : s;
+    *cosine = ((q + 1) & 2) ? -c : c;
+}
+
+#if defined(__AVX2__)
+static inline void llv3_sincos8(__m256 angle, __m256 * sine, __m256 * cosine)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    __m256i q  = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(LLv3_2_OVER_PI)));
+    __m256  qf = _mm256_cvtepi32_ps(q);
+    __m256  r  = _mm256_sub_ps(angle, _mm256_mul_ps(qf, _mm256_set1_ps(LLv3_PIO2_A)));
+    __m256  r2, s, c, swap;
+
+    r  = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(LLv3_PIO2_B)));
+    r  = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(LLv3_PIO2_C)));
+    r2 = _mm256_mul_ps(r, r);
+
+    s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(LLv3_SIN_P0), r2), _mm256_set1_ps(LLv3_SIN_P1));
+    s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(LLv3_SIN_P2));
+    s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, r2), r), r);
+
+    c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(LLv3_COS_P0), r2), _mm256_set1_ps(LLv3_COS_P1));
+    c = _mm256_add_ps(_mm256_mul_ps(c, r2), _mm256_set1_ps(LLv3_COS_P2));
+    c = _mm256_mul_ps(_mm256_mul_ps(c, r2), r2);
+    c = _mm256_add_ps(_mm256_sub_ps(c, _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_set1_ps(1.0f));
+
+    swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+
+    *sine   = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap),
+                            _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30)));
+    *cosine = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap),
+                            _mm256_castsi256_ps(_mm256_slli_epi32(
+                                _mm256_and_si256(_mm256_add_epi32(q, one), two), 30)));
+}
+#elif defined(__SSE2__)
+static inline void llv3_sincos4(__m128 angle, __m128 * sine, __m128 * cosine)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    __m128i q  = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(LLv3_2_OVER_PI)));
+    __m128  qf = _mm_cvtepi32_ps(q);
+    __m128  r  = _mm_sub_ps(angle, _mm_mul_ps(qf, _mm_set1_ps(LLv3_PIO2_A)));
+    __m128  r2, s, c, swap;
+
+    r  = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(LLv3_PIO2_B)));
+    r  = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(LLv3_PIO2_C)));
+    r2 = _mm_mul_ps(r, r);
+
+    s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(LLv3_SIN_P0), r2), _mm_set1_ps(LLv3_SIN_P1));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(LLv3_SIN_P2));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+    c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(LLv3_COS_P0), r2), _mm_set1_ps(LLv3_COS_P1));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(LLv3_COS_P2));
+    c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_set1_ps(1.0f));
+
+    swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+
+    // SSE2 has no blend; select with and/andnot/or
+    *sine   = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)),
+                         _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30)));
+    *cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)),
+                         _mm_castsi128_ps(_mm_slli_epi32(
+                             _mm_and_si128(_mm_add_epi32(q, one), two), 30)));
+}
+#elif defined(__ARM_NEON)
+static inline void llv3_sincos4(float32x4_t angle, float32x4_t * sine, float32x4_t * cosine)
+{
+    const int32x4_t one = vdupq_n_s32(1);
+    const int32x4_t two = vdupq_n_s32(2);
+    float32x4_t t  = vmulq_n_f32(angle, LLv3_2_OVER_PI);
+    float32x4_t half = vbslq_f32(vcltq_f32(t, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    int32x4_t   q  = vcvtq_s32_f32(vaddq_f32(t, half)); // Round half away from zero
+    float32x4_t qf = vcvtq_f32_s32(q);
+    float32x4_t r  = vmlsq_n_f32(angle, qf, LLv3_PIO2_A);
+    float32x4_t r2, s, c;
+    uint32x4_t  swap;
+
+    r  = vmlsq_n_f32(r, qf, LLv3_PIO2_B);
+    r  = vmlsq_n_f32(r, qf, LLv3_PIO2_C);
+    r2 = vmulq_f32(r, r);
+
+    s = vmlaq_n_f32(vdupq_n_f32(LLv3_SIN_P1), r2, LLv3_SIN_P0);
+    s = vmlaq_f32(vdupq_n_f32(LLv3_SIN_P2), s, r2);
+    s = vmlaq_f32(r, vmulq_f32(s, r2), r);
+
+    c = vmlaq_n_f32(vdupq_n_f32(LLv3_COS_P1), r2, LLv3_COS_P0);
+    c = vmlaq_f32(vdupq_n_f32(LLv3_COS_P2), c, r2);
+    c = vmulq_f32(vmulq_f32(c, r2), r2);
+    c = vaddq_f32(vmlsq_n_f32(c, r2, 0.5f), vdupq_n_f32(1.0f));
+
+    swap = vceqq_s32(vandq_s32(q, one), one);
+
+    *sine   = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, c, s)),
+                                              vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(q, two), 30))));
+    *cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, s, c)),
+                                              vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(vaddq_s32(q, one), two), 30))));
+}
+#endif
+
+/*------------------------------------------------------------------------------
+  Polar to Cartesian
+  x = range * cos(tilt) * cos(pan), y = range * cos(tilt) * sin(pan),
+  z = range * sin(tilt), eight or four points per iteration where SIMD is
+  available and one at a time for the remainder
+------------------------------------------------------------------------------*/
+void llv3_polarToCartesian(const float * range, const float * pan, const float * tilt,
+                           float * x, float * y, float * z, __u32 count)
+{
+    __u32 i = 0;
+    float sp, cp, st, ct;
+
+#if defined(__AVX2__)
+    for ( ; i + 8 <= count ; i += 8)
+    {
+        __m256 r = _mm256_loadu_ps(&range[i]);
+        __m256 sp8, cp8, st8, ct8, h;
+
+        llv3_sincos8(_mm256_loadu_ps(&pan[i]),  &sp8, &cp8);
+        llv3_sincos8(_mm256_loadu_ps(&tilt[i]), &st8, &ct8);
+
+        h = _mm256_mul_ps(r, ct8);
+        _mm256_storeu_ps(&x[i], _mm256_mul_ps(h, cp8));
+        _mm256_storeu_ps(&y[i], _mm256_mul_ps(h, sp8));
+        _mm256_storeu_ps(&z[i], _mm256_mul_ps(r, st8));
+    }
+#elif defined(__SSE2__)
+    for ( ; i + 4 <= count ; i += 4)
+    {
+        __m128 r = _mm_loadu_ps(&range[i]);
+        __m128 sp4, cp4, st4, ct4, h;
+
+        llv3_sincos4(_mm_loadu_ps(&pan[i]),  &sp4, &cp4);
+        llv3_sincos4(_mm_loadu_ps(&tilt[i]), &st4, &ct4);
+
+        h = _mm_mul_ps(r, ct4);
+        _mm_storeu_ps(&x[i], _mm_mul_ps(h, cp4));
+        _mm_storeu_ps(&y[i], _mm_mul_ps(h, sp4));
+        _mm_storeu_ps(&z[i], _mm_mul_ps(r, st4));
+    }
+#elif defined(__ARM_NEON)
+    for ( ; i + 4 <= count ; i += 4)
+    {
+        float32x4_t r = vld1q_f32(&range[i]);
+        float32x4_t sp4, cp4, st4, ct4, h;
+
+        llv3_sincos4(vld1q_f32(&pan[i]),  &sp4, &cp4);
+        llv3_sincos4(vld1q_f32(&tilt[i]), &st4, &ct4);
+
+        h = vmulq_f32(r, ct4);
+        vst1q_f32(&x[i], vmulq_f32(h, cp4));
+        vst1q_f32(&y[i], vmulq_f32(h, sp4));
+        vst1q_f32(&z[i], vmulq_f32(r, st4));
+    }
+#endif
+
+    for ( ; i<count ; i++)
+    {
+        llv3_sincos(pan[i],  &sp, &cp);
+        llv3_sincos(tilt[i], &st, &ct);
+
+        x[i] = range[i] * ct * cp;
+        y[i] = range[i] * ct * sp;
+        z[i] = range[i] * st;
+    }
+} /* llv3_polarToCartesian */
+
+/*------------------------------------------------------------------------------
+  Constructor
+  Allocates the frame pool; no further allocation happens while scanning.
+
+  Parameters
+  ------------------------------------------------------------------------------
+  lidarlite: initialized LIDARLite_v3 instance used by step()
+  source:    called with each sample's measurement time to get the angles
+  context:   passed to 'source'
+  lidarliteAddress: Default 0x62. Fill in new address here if changed. See
+    operating manual for instructions.
+------------------------------------------------------------------------------*/
+LIDARLite_v3_Sweep::LIDARLite_v3_Sweep(LIDARLite_v3 * lidarlite, LLv3_AngleSource source,
+                                       void * context, __u8 lidarliteAddress)
+{
+    void * memory = NULL;
+
+    lidar        = lidarlite;
+    angleSource  = source;
+    angleContext = context;
+    address      = lidarliteAddress;
+    current      = NULL;
+    sequence     = 0;
+    memset(inUse, 0, sizeof(inUse));
+
+    if (posix_memalign(&memory, 64, LLv3_SCAN_POOL_SIZE * sizeof(LLv3_ScanFrame)) != 0)
+    {
+        //ERROR HANDLING: begin() fails while there is no pool
+        printf("Failed to allocate the scan frame pool.\n");
+        memory = NULL;
+    }
+
+    pool = (LLv3_ScanFrame *) memory;
+}
+
+LIDARLite_v3_Sweep::~LIDARLite_v3_Sweep(void)
+{
+    free(pool);
+}
+
+/*------------------------------------------------------------------------------
+  Begin
+  Start a new scan in a free frame of the pool. Returns 0 on success (or if
+  a scan is already open) and -1 if every frame is still held by the caller.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Sweep::begin(void)
+{
+    __u8 i;
+
+    if (current)
+        return 0;
+
+    if (pool == NULL)
+        return -1;
+
+    for (i=0 ; i<LLv3_SCAN_POOL_SIZE ; i++)
+    {
+        if (!inUse[i])
+        {
+            inUse[i] = 1;
+            current  = &pool[i];
+
+            current->sequence  = sequence++;
+            current->startTime = 0;
+            current->endTime   = 0;
+            current->numPoints = 0;
+            current->dropped   = 0;
+            current->address   = address;
+
+            return 0;
+        }
+    }
+
+    return -1;
+} /* LIDARLite_v3_Sweep::begin */
+
+/*------------------------------------------------------------------------------
+  Step
+  Take one measurement with LIDARLite_v3::measure() and add it to the open
+  scan. Returns as addSample().
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Sweep::step(void)
+{
+    LLv3_Sample sample;
+
+    if (current == NULL)
+        return -1;
+
+    lidar->measure(&sample, address);
+
+    return addSample(&sample);
+} /* LIDARLite_v3_Sweep::step */
+
+/*------------------------------------------------------------------------------
+  Add Sample
+  Add a sample taken elsewhere (scheduler, async API, replay) to the open
+  scan. The angles are looked up at the sample's measurement time: the
+  midpoint of trigger and completion when both are known.
+
+  Returns 1 if a point was added, 0 if the sample was invalid and dropped,
+  or -1 if no scan is open or the frame is full.
+------------------------------------------------------------------------------*/
+__s32 LIDARLite_v3_Sweep::addSample(const LLv3_Sample * sample)
+{
+    __u64 time = sample->timestamp;
+    __u32 n;
+
+    if (current == NULL || current->numPoints == LLv3_SCAN_MAX_POINTS)
+        return -1;
+
+    if (sample->status & LLv3_STATUS_UNUSABLE)
+    {
+        current->dropped++;
+        return 0;
+    }
+
+    if (sample->trigger && sample->trigger < sample->timestamp)
+        time -= (sample->timestamp - sample->trigger) / 2;
+
+    n = current->numPoints++;
+
+    angleSource(time, &current->pan[n], &current->tilt[n], angleContext);
+
+    current->range[n]     = sample->distance * 0.01f;
+    current->timestamp[n] = time;
+
+    if (n == 0)
+        current->startTime = time;
+    current->endTime = time;
+
+    return 1;
+} /* LIDARLite_v3_Sweep::addSample */
+
+/*------------------------------------------------------------------------------
+  End
+  Close the open scan, convert all of its points to Cartesian coordinates
+  and return it. The frame stays valid until passed to release(). Returns
+  NULL if no scan is open.
+------------------------------------------------------------------------------*/
+LLv3_ScanFrame * LIDARLite_v3_Sweep::end(void)
+{
+    LLv3_ScanFrame * frame = current;
+
+    if (frame == NULL)
+        return NULL;
+
+    llv3_polarToCartesian(frame->range, frame->pan, frame->tilt,
+                          frame->x, frame->y, frame->z, frame->numPoints);
+
+    current = NULL;
+
+    return frame;
+} /* LIDARLite_v3_Sweep::end */
+
+/*------------------------------------------------------------------------------
+  Release
+  Return a frame obtained from end() to the pool
+------------------------------------------------------------------------------*/
+void LIDARLite_v3_Sweep::release(LLv3_ScanFrame * frame)
+{
+    if (frame >= pool && frame < pool + LLv3_SCAN_POOL_SIZE)
+        inUse[frame - pool] = 0;
+} /* LIDARLite_v3_Sweep::release */
+
+/*------------------------------------------------------------------------------
+  Write PCD
+  Binary PCD stores points interleaved, so the frame's arrays are
+  interleaved through a small buffer on the way out.
+------------------------------------------------------------------------------*/
+__s32 llv3_writePcd(const char * path, const LLv3_ScanFrame * frame)
+{
+    float  buffer[256][4];
+    FILE * file;
+    __u32  i;
+    __u32  j;
+    __u32  n;
+    __s32  result = 0;
+
+    if ((file = fopen(path, "wb")) == NULL)
+    {
+        //ERROR HANDLING: you can check errno to see what went wrong
+        printf("Failed to create the point cloud file.\n");
+        return -1;
+    }
+
+    fprintf(file,
+            "# .PCD v0.7 - Point Cloud Data file format\n"
+            "VERSION 0.7\n"
+            "FIELDS x y z range\n"
+            "SIZE 4 4 4 4\n"
+            "TYPE F F F F\n"
+            "COUNT 1 1 1 1\n"
+            "WIDTH %u\n"
+            "HEIGHT 1\n"
+            "VIEWPOINT 0 0 0 1 0 0 0\n"
+            "POINTS %u\n"
+            "DATA binary\n",
+            frame->numPoints, frame->numPoints);
+
+    for (i=0 ; i<frame->numPoints ; i+=n)
+    {
+        n = frame->numPoints - i;
+        if (n > 256)
+            n = 256;
+
+        for (j=0 ; j<n ; j++)
+        {
+            buffer[j][0] = frame->x[i + j];
+            buffer[j][1] = frame->y[i + j];
+            buffer[j][2] = frame->z[i + j];
+            buffer[j][3] = frame->range[i + j];
+        }
+
+        if (fwrite(buffer, sizeof(buffer[0]), n, file) != n)
+            result = -1;
+    }
+
+    if (fclose(file) != 0)
+        result = -1;
+
+    return result;
+} /* llv3_writePcd */
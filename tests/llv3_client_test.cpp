@@ -0,0 +1,97 @@
+/*------------------------------------------------------------------------------
+  Test for LIDARLite_v3_Client::readDistance, run against the simulated
+  register model. A broker publishes measurements of a target moving in and
+  out of range; while the newest sample has no usable distance the client
+  must report 0 rather than the placeholder distance of the sample.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_broker.h>
+
+#ifndef LLv3_TRANSPORT_SIM
+#error "llv3_client_test needs the simulated transport (-DLLv3_TRANSPORT_SIM)"
+#endif
+
+#define BUS_NUMBER 1
+#define SHM_NAME   "/llv3_client_test"
+#define NEAR_CM    100
+#define FAR_CM     2000 // Beyond the range of preset 6
+
+int main()
+{
+    LIDARLite_v3 lidar;
+    LLv3_Sample  sample;
+    __u32 failures = 0;
+    __u16 distance;
+    __u8  far;
+    __u8  i;
+
+    LLv3_SimModel::get(BUS_NUMBER)->addDevice(LIDARLITE_ADDR_DEFAULT, 0x1234);
+
+    if (lidar.i2c_init(BUS_NUMBER) < 0)
+        return 1;
+
+    lidar.configure(6);
+
+    LIDARLite_v3_Broker broker(&lidar);
+    LIDARLite_v3_Client client;
+
+    broker.addSensor(LIDARLITE_ADDR_DEFAULT);
+
+    if (broker.open(SHM_NAME) < 0 || client.connect(SHM_NAME) < 0)
+        return 1;
+
+    for (i=0 ; i<8 ; i++)
+    {
+        far = i & 1;
+        LLv3_SimModel::get(BUS_NUMBER)->setDistance(LIDARLITE_ADDR_DEFAULT, far ? FAR_CM : NEAR_CM);
+
+        // The first pass harvests the measurement started before the move
+        while (broker.step() == 0);
+        while (broker.step() == 0);
+
+        if (client.getLatest(&sample) < 0)
+        {
+            printf("FAIL step %u: no sample published\n", i);
+            failures++;
+            continue;
+        }
+
+        distance = client.readDistance();
+
+        if (far && (!(sample.status & LLv3_STATUS_UNUSABLE) || distance != 0))
+        {
+            printf("FAIL step %u: no-signal sample read as %u cm, status 0x%02x\n",
+                   i, distance, sample.status);
+            failures++;
+        }
+
+        if (!far && distance != NEAR_CM)
+        {
+            printf("FAIL step %u: valid sample read as %u cm, status 0x%02x\n",
+                   i, distance, sample.status);
+            failures++;
+        }
+    }
+
+    client.disconnect();
+    broker.close();
+
+    printf("%s llv3_client_test\n", failures ? "FAIL" : "ok");
+
+    return failures ? 1 : 0;
+}
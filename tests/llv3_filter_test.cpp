@@ -0,0 +1,85 @@
+/*------------------------------------------------------------------------------
+  Test for LLv3_FilterPipeline fed with samples. Samples without a usable
+  distance (a failed measurement with distance 0, a no-signal return with
+  1 cm) must neither change the output nor pull later outputs toward them.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+#include <cmath>
+
+#include <include/lidarlite_v3.h>
+#include <include/lidarlite_v3_filter.h>
+
+#define TARGET_CM 500
+
+int main()
+{
+    LLv3_MedianFilter   median(5);
+    LLv3_EmaFilter      ema(0.5f);
+    LLv3_FilterPipeline pipeline;
+    LLv3_Sample sample;
+    __u32 failures = 0;
+    float output;
+    __u32 i;
+
+    pipeline.addStage(&median);
+    pipeline.addStage(&ema);
+
+    sample.trigger = 0;
+    sample.address = LIDARLITE_ADDR_DEFAULT;
+    sample.bus     = 1;
+    sample.signal  = 100;
+
+    for (i=0 ; i<40 ; i++)
+    {
+        sample.timestamp = i * 10000000ull;
+
+        // Every other sample is a dropout, alternating between both kinds
+        if (i & 1)
+        {
+            sample.distance = (i & 2) ? 0 : 1;
+            sample.status   = (i & 2) ? LLv3_STATUS_INVALID : LLv3_STATUS_NO_SIGNAL;
+        }
+        else
+        {
+            sample.distance = TARGET_CM;
+            sample.status   = 0;
+        }
+
+        output = pipeline.update(&sample);
+
+        if (fabsf(output - TARGET_CM) > 0.01f)
+        {
+            printf("FAIL sample %u (distance %u, status 0x%02x): output %.2f\n",
+                   i, sample.distance, sample.status, output);
+            failures++;
+        }
+    }
+
+    // Before any usable sample there is no output to repeat
+    pipeline.reset();
+    sample.distance = 0;
+    sample.status   = LLv3_STATUS_INVALID;
+
+    if (pipeline.update(&sample) != 0.0f || median.getCount() != 0)
+    {
+        printf("FAIL dropout after reset reached the stages\n");
+        failures++;
+    }
+
+    printf("%s llv3_filter_test\n", failures ? "FAIL" : "ok");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+/*------------------------------------------------------------------------------
+  Test for LLv3_WAIT_GPIO, run against the simulated register model. The
+  mode pin only says when a measurement ends, so the status of every sample
+  must still come from that measurement: a target alternating between
+  inside and beyond the range of preset 6 has to give alternating valid
+  and no-signal samples.
+
+  Copyright (c) 2019 Garmin Ltd. or its subsidiaries.
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+------------------------------------------------------------------------------*/
+
+#include <linux/types.h>
+#include <cstdio>
+
+#include <include/lidarlite_v3.h>
+
+#ifndef LLv3_TRANSPORT_SIM
+#error "llv3_gpio_test needs the simulated transport (-DLLv3_TRANSPORT_SIM)"
+#endif
+
+#define BUS_NUMBER 1
+#define NEAR_CM    100
+#define FAR_CM     2000 // Beyond the range of preset 6
+
+int main()
+{
+    LIDARLite_v3 lidar;
+    LLv3_Sample  sample;
+    __u32 failures = 0;
+    __u8  far;
+    __u8  i;
+
+    LLv3_SimModel::get(BUS_NUMBER)->addDevice(LIDARLITE_ADDR_DEFAULT, 0x1234);
+
+    if (lidar.i2c_init(BUS_NUMBER) < 0)
+        return 1;
+
+    // Preset 6 puts the mode pin in status output mode
+    lidar.configure(6);
+    lidar.setWaitPolicy(LLv3_WAIT_GPIO);
+
+    if (lidar.gpioInit("sim", LIDARLITE_ADDR_DEFAULT) < 0)
+        return 1;
+
+    for (i=0 ; i<16 ; i++)
+    {
+        far = i & 1;
+        LLv3_SimModel::get(BUS_NUMBER)->setDistance(LIDARLITE_ADDR_DEFAULT, far ? FAR_CM : NEAR_CM);
+
+        if (lidar.measure(&sample) != LLv3_OK)
+        {
+            printf("FAIL measurement %u: measure failed\n", i);
+            failures++;
+            continue;
+        }
+
+        if (far && !(sample.status & LLv3_STATUS_NO_SIGNAL))
+        {
+            printf("FAIL measurement %u: no-signal return reported with status 0x%02x\n", i, sample.status);
+            failures++;
+        }
+
+        if (!far && (sample.status & LLv3_STATUS_UNUSABLE || sample.distance != NEAR_CM))
+        {
+            printf("FAIL measurement %u: valid return reported as %u cm, status 0x%02x\n",
+                   i, sample.distance, sample.status);
+            failures++;
+        }
+    }
+
+    printf("%s llv3_gpio_test\n", failures ? "FAIL" : "ok");
+
+    return failures ? 1 : 0;
+}